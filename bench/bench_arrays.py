@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""
+数组批量操作基准
+
+对每种内置批量操作（fill、copy、sum、dot、add、mul、min、max），
+分别计时调用内置函数的循环和用解释执行的 for 循环完成同样工作的循环，
+报告每个元素的平均耗时和加速比，并核对两种写法打印的结果一致。
+
+计时在进程内通过 C 引擎共享库进行：初始化只运行一次，之后每次 ci_run 只执行重复 rounds 次的循环，
+rounds 自动加倍直到一次运行至少耗时 --min-time 秒；再扣除同样 rounds 次的空循环的耗时。
+扣除后的差值不超过多次测量之间的波动时，该点视为噪声，不报告。
+
+用法：
+    gcc -O2 -shared -fPIC -fvisibility=hidden -pthread -DCI_LIBRARY -o libc_interpreter.so c_interpreter.c
+    python bench/bench_arrays.py --lengths 1000,100000
+"""
+
+import argparse
+import os
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import mini_interpreter
+
+SETUP = '''int n = %(length)d;
+int a[n];
+int b[n];
+int c[n];
+for (int i = 0; i < n; i = i + 1) {
+    a[i] = i * 7 - n;
+    b[i] = n - i * 3;
+}
+int r = 0;
+'''
+
+# 每种操作：(内置函数写法, 解释执行的循环写法)，都会重复 rounds 次
+OPS = {
+    'fill': ('fill(c, k);',
+             'for (int i = 0; i < n; i = i + 1) { c[i] = k; }'),
+    'copy': ('copy(c, a);',
+             'for (int i = 0; i < n; i = i + 1) { c[i] = a[i]; }'),
+    'sum': ('r = r + sum(a);',
+            'for (int i = 0; i < n; i = i + 1) { r = r + a[i]; }'),
+    'dot': ('r = r + dot(a, b);',
+            'for (int i = 0; i < n; i = i + 1) { r = r + a[i] * b[i]; }'),
+    'add': ('add(c, a, b);',
+            'for (int i = 0; i < n; i = i + 1) { c[i] = a[i] + b[i]; }'),
+    'mul': ('mul(c, a, b);',
+            'for (int i = 0; i < n; i = i + 1) { c[i] = a[i] * b[i]; }'),
+    'min': ('r = min(a);',
+            'r = a[0]; for (int i = 1; i < n; i = i + 1) { if (a[i] < r) { r = a[i]; } }'),
+    'max': ('r = max(a);',
+            'r = a[0]; for (int i = 1; i < n; i = i + 1) { if (a[i] > r) { r = a[i]; } }'),
+}
+
+REPEAT = '''for (int k = 0; k < %(rounds)d; k = k + 1) {
+    %(body)s
+}
+'''
+
+CHECK = '''print(r);
+print(c[n / 2]);
+'''
+
+
+def create(lib, length):
+    handle = lib.ci_create()
+    execute(lib, handle, SETUP % {'length': length})
+    return handle
+
+
+def execute(lib, handle, code):
+    if lib.ci_run(handle, code.encode('utf-8')) != 0:
+        raise SystemExit(lib.ci_last_error(handle).decode('utf-8', 'replace'))
+    output = lib.ci_output(handle).decode('utf-8')
+    lib.ci_clear_output(handle)
+    return output
+
+
+def check(lib, length, rounds, name):
+    outputs = []
+    for body in OPS[name]:
+        handle = create(lib, length)
+        try:
+            outputs.append(execute(lib, handle, REPEAT % {'rounds': rounds, 'body': body} + CHECK))
+        finally:
+            lib.ci_destroy(handle)
+    if outputs[0] != outputs[1]:
+        raise SystemExit(f'{name}: bulk printed {outputs[0]!r}, loop printed {outputs[1]!r}')
+
+
+def sample(lib, handle, body, rounds, repeat):
+    code = REPEAT % {'rounds': rounds, 'body': body}
+    times = []
+    for _ in range(repeat):
+        start = time.perf_counter()
+        execute(lib, handle, code)
+        times.append(time.perf_counter() - start)
+    return min(times), max(times) - min(times)
+
+
+def measure(lib, handle, body, min_time, repeat):
+    """返回每轮的耗时（秒），差值在噪声范围内时返回 None"""
+    rounds = 1
+    while True:
+        best, spread = sample(lib, handle, body, rounds, repeat)
+        if best >= min_time:
+            break
+        rounds *= 2
+    empty, empty_spread = sample(lib, handle, '', rounds, repeat)
+    work = best - empty
+    if work <= spread + empty_spread:
+        return None
+    return work / rounds
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Bulk array operations vs interpreted loops')
+    parser.add_argument('--lengths', default='1000,100000', help='comma separated array lengths')
+    parser.add_argument('--min-time', type=float, default=0.05, help='minimum seconds per timed run')
+    parser.add_argument('--repeat', type=int, default=5, help='runs per point, fastest is kept')
+    parser.add_argument('--ops', default=','.join(OPS), help='comma separated operations')
+    args = parser.parse_args()
+
+    lib = mini_interpreter.c_engine
+    if lib is None:
+        raise SystemExit('C engine library not found')
+
+    print(f"{'length':>8}{'op':>6}{'bulk ns/el':>12}{'loop ns/el':>12}{'speedup':>9}")
+    for length in (int(value) for value in args.lengths.split(',')):
+        handle = create(lib, length)
+        try:
+            for name in args.ops.split(','):
+                check(lib, length, 3, name)
+                bulk, loop = (measure(lib, handle, body, args.min_time, args.repeat) for body in OPS[name])
+                bulk_text = f'{bulk * 1e9 / length:>12.3f}' if bulk is not None else f"{'noise':>12}"
+                loop_text = f'{loop * 1e9 / length:>12.1f}' if loop is not None else f"{'noise':>12}"
+                speedup = f'{loop / bulk:>8.0f}x' if bulk is not None and loop is not None else f"{'-':>9}"
+                print(f"{length:>8}{name:>6}{bulk_text}{loop_text}{speedup}")
+        finally:
+            lib.ci_destroy(handle)
+
+
+if __name__ == '__main__':
+    main()
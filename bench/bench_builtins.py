@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+内置函数基准
+
+对每个标量内置函数（abs、min、max、pow、mod、gcd、popcount），
+在同样的循环中分别调用内置函数和用 def 写成的等价解释执行函数，
+扣除只执行空循环的基线耗时，报告每次调用的平均耗时和加速比，并核对两种写法的结果一致。
+
+用法：
+    gcc -O2 -o c_interpreter c_interpreter.c -pthread
+    python bench/bench_builtins.py --calls 200000
+"""
+
+import argparse
+import os
+import subprocess
+import tempfile
+import time
+
+# 每个内置函数：(等价的 def, 调用表达式)；调用表达式中的 F 替换为函数名
+FUNCTIONS = {
+    'abs': ('''def my_abs(int x) {
+    int r = x;
+    if (x < 0) {
+        r = 0 - x;
+    }
+    return r;
+}''', 'F(i - half)'),
+    'min': ('''def my_min(int a, int b) {
+    int r = a;
+    if (b < a) {
+        r = b;
+    }
+    return r;
+}''', 'F(i, half)'),
+    'max': ('''def my_max(int a, int b) {
+    int r = a;
+    if (b > a) {
+        r = b;
+    }
+    return r;
+}''', 'F(i, half)'),
+    'pow': ('''def my_pow(int b, int e) {
+    int r = 1;
+    for (int k = 0; k < e; k = k + 1) {
+        r = r * b;
+    }
+    return r;
+}''', 'F(i / 1000 + 2, 3)'),
+    'mod': ('''def my_mod(int a, int b) {
+    return a - a / b * b;
+}''', 'F(i, 97)'),
+    'gcd': ('''def my_gcd(int a, int b) {
+    for (int k = 0; b != 0; k = k + 1) {
+        int t = a - a / b * b;
+        a = b;
+        b = t;
+    }
+    return a;
+}''', 'F(i, 360)'),
+    'popcount': ('''def my_popcount(int x) {
+    int c = 0;
+    for (int k = 0; x != 0; k = k + 1) {
+        c = c + x - x / 2 * 2;
+        x = x / 2;
+    }
+    return c;
+}''', 'F(i)'),
+}
+
+LOOP = '''int n = %(calls)d;
+int half = n / 2;
+int acc = 0;
+for (int i = 0; i < n; i = i + 1) {
+    acc = acc + %(call)s;
+}
+print(acc);
+'''
+
+
+def run(binary, source, repeat):
+    fd, path = tempfile.mkstemp(suffix='.c')
+    with os.fdopen(fd, 'w') as out:
+        out.write(source)
+    try:
+        best = None
+        out = None
+        for _ in range(repeat):
+            start = time.perf_counter()
+            out = subprocess.run([binary, path], check=True, capture_output=True, text=True).stdout
+            elapsed = time.perf_counter() - start
+            best = elapsed if best is None else min(best, elapsed)
+        return out, best
+    finally:
+        os.remove(path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Native builtins vs interpreted def equivalents')
+    parser.add_argument('--bin', default='./c_interpreter', help='interpreter binary (default ./c_interpreter)')
+    parser.add_argument('--calls', type=int, default=200000, help='calls per function')
+    parser.add_argument('--repeat', type=int, default=3, help='runs per point, fastest is kept')
+    args = parser.parse_args()
+
+    _, base = run(args.bin, LOOP % {'calls': args.calls, 'call': '0'}, args.repeat)
+    print(f"{args.calls} calls per function, empty loop {base * 1000:.1f} ms\n")
+    print(f"{'function':>10}{'builtin ns':>12}{'def ns':>10}{'speedup':>9}")
+    for name, (definition, call) in FUNCTIONS.items():
+        builtin_out, builtin_time = run(args.bin, LOOP % {'calls': args.calls, 'call': call.replace('F', name)},
+                                        args.repeat)
+        def_out, def_time = run(args.bin, definition + '\n' +
+                                LOOP % {'calls': args.calls, 'call': call.replace('F', 'my_' + name)}, args.repeat)
+        if builtin_out != def_out:
+            raise SystemExit(f'{name}: builtin printed {builtin_out!r}, def printed {def_out!r}')
+        builtin_time = max(builtin_time - base, 1e-9)
+        def_time = max(def_time - base, 1e-9)
+        print(f"{name:>10}{builtin_time * 1e9 / args.calls:>12.1f}{def_time * 1e9 / args.calls:>10.1f}"
+              f"{def_time / builtin_time:>8.1f}x")
+
+
+if __name__ == '__main__':
+    main()
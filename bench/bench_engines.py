@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""
+执行引擎对比基准
+
+用 mini_interpreter 中的各个引擎（逐节点解释的 python、闭包编译的 closure、
+找到共享库时的 c）运行同样的循环密集和调用密集的脚本，
+报告耗时和相对 python 引擎的加速比，并核对各引擎的输出一致。
+
+用法：
+    gcc -O2 -shared -fPIC -fvisibility=hidden -pthread -DCI_LIBRARY -o libc_interpreter.so c_interpreter.c
+    python bench/bench_engines.py --scale 1
+"""
+
+import argparse
+import os
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import mini_interpreter
+
+SCRIPTS = {
+    'loop': '''int total = 0;
+for (int i = 0; i < %(n)d; i = i + 1) {
+    int x = i * 3 - total / 7;
+    if (x > 100) {
+        total = total + x / 5;
+    } else {
+        total = total + 1;
+    }
+}
+print(total);
+''',
+    'calls': '''def step(int a, int b) {
+    int c = a * 2 + b;
+    return c / 3;
+}
+int acc = 1;
+for (int i = 0; i < %(n)d; i = i + 1) {
+    acc = step(acc, i) + step(i, 1);
+}
+print(acc);
+''',
+    'recursion': '''def fib(int n) {
+    int r = n;
+    if (n > 1) {
+        r = fib(n - 1) + fib(n - 2);
+    }
+    return r;
+}
+print(fib(%(depth)d));
+''',
+}
+
+
+def engines():
+    result = {'python': mini_interpreter.PythonInterpreter, 'closure': mini_interpreter.ClosureInterpreter}
+    if mini_interpreter.c_engine is not None:
+        result['c'] = mini_interpreter.CInterpreter
+    return result
+
+
+def run(factory, code, repeat):
+    best = None
+    out = None
+    for _ in range(repeat):
+        interpreter = factory()
+        start = time.perf_counter()
+        out = interpreter.run(code, capture=True)
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return out, best
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare mini_interpreter execution engines')
+    parser.add_argument('--scale', type=float, default=1.0, help='multiplies the iteration counts')
+    parser.add_argument('--repeat', type=int, default=3, help='runs per point, fastest is kept')
+    args = parser.parse_args()
+
+    params = {'n': int(20000 * args.scale), 'depth': 16 + int(args.scale).bit_length()}
+    available = engines()
+    if 'c' not in available:
+        print('C engine library not found; only the pure-Python engines are measured\n')
+
+    print(f"{'script':>10}" + ''.join(f"{name + ' ms':>12}" for name in available) +
+          ''.join(f"{name + ' x':>11}" for name in available if name != 'python'))
+    for name, template in SCRIPTS.items():
+        code = template % params
+        outputs = {}
+        times = {}
+        for engine, factory in available.items():
+            outputs[engine], times[engine] = run(factory, code, args.repeat)
+        for engine, out in outputs.items():
+            if out != outputs['python']:
+                raise SystemExit(f'{name}: {engine} printed {out!r}, python printed {outputs["python"]!r}')
+        print(f"{name:>10}" + ''.join(f"{times[engine] * 1000:>12.1f}" for engine in available) +
+              ''.join(f"{times['python'] / times[engine]:>10.1f}x" for engine in available if engine != 'python'))
+
+
+if __name__ == '__main__':
+    main()
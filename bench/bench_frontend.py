@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+前端扩展性基准
+
+用 gen_program.py 生成从 1 KB 到数百 MB 的程序，调用
+`c_interpreter --bench-frontend` 只做词法和语法分析，
+报告耗时、内存和 nodes/sec，并按相邻两个规模的 log-log 斜率
+标出非线性增长（斜率明显大于 1）。
+
+用法：
+    gcc -O2 -o c_interpreter c_interpreter.c
+    python bench/bench_frontend.py --max-size 256M
+    python bench/bench_frontend.py --shape nested --json results.jsonl
+    python bench/bench_frontend.py --jobs 1,2,4,8 --sizes 64M,256M
+
+--jobs 大于 1 时使用并行前端，词法和语法分析交错进行，只能报告总耗时（total ms）；
+speedup 为相对同一输入下第一个 jobs 值的加速比。
+"""
+
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from gen_program import SHAPES, ProgramGenerator, parse_size
+
+DEFAULT_SIZES = '1K,16K,256K,4M,64M,256M'
+NONLINEAR_SLOPE = 1.2
+
+
+def run_frontend(binary, path, repeat, jobs):
+    """多次运行取最快的一次"""
+    best = None
+    for _ in range(repeat):
+        out = subprocess.run([binary, '--jobs', str(jobs), '--bench-frontend', path],
+                             check=True, capture_output=True, text=True).stdout
+        stats = dict(field.split('=', 1) for field in out.split())
+        stats = {k: float(v) for k, v in stats.items()}
+        if best is None or stats['total_ms'] < best['total_ms']:
+            best = stats
+    return best
+
+
+def slope(prev, cur, key):
+    if prev is None or prev[key] <= 0 or cur[key] <= 0:
+        return None
+    return math.log(cur[key] / prev[key]) / math.log(cur['bytes'] / prev['bytes'])
+
+
+def fmt_slope(value):
+    if value is None:
+        return '     -'
+    mark = '!' if value > NONLINEAR_SLOPE else ' '
+    return f'{value:5.2f}{mark}'
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Front-end scaling benchmark for c_interpreter')
+    parser.add_argument('--bin', default='./c_interpreter', help='interpreter binary (default ./c_interpreter)')
+    parser.add_argument('--shape', action='append', choices=SHAPES,
+                        help='program shape, may be repeated (default: all)')
+    parser.add_argument('--sizes', default=DEFAULT_SIZES, help=f'comma separated sizes (default {DEFAULT_SIZES})')
+    parser.add_argument('--max-size', help='drop sizes above this limit')
+    parser.add_argument('--repeat', type=int, default=3, help='runs per point, fastest is kept')
+    parser.add_argument('--jobs', default='1', help='comma separated front-end thread counts (default 1)')
+    parser.add_argument('--workdir', help='keep generated programs here instead of a temp dir')
+    parser.add_argument('--json', help='append one JSON object per point to this file')
+    args = parser.parse_args()
+
+    sizes = [parse_size(s) for s in args.sizes.split(',')]
+    if args.max_size:
+        limit = parse_size(args.max_size)
+        sizes = [s for s in sizes if s <= limit]
+    shapes = args.shape or list(SHAPES)
+    workdir = args.workdir or tempfile.mkdtemp(prefix='ci_bench_')
+    os.makedirs(workdir, exist_ok=True)
+
+    jobs_list = [int(j) for j in args.jobs.split(',')]
+    print(f"{'shape':<12}{'bytes':>12}{'jobs':>5}{'tokens':>12}{'nodes':>12}{'lex ms':>10}{'parse ms':>10}"
+          f"{'total ms':>10}{'MB/s':>8}{'Mnodes/s':>10}{'speedup':>8}{'B/node':>8}{'RSS MB':>8}"
+          f"{'lex k':>7}{'parse k':>8}{'total k':>8}")
+    results = []
+    for shape in shapes:
+        prev = {}
+        for size in sizes:
+            path = os.path.join(workdir, f'{shape}_{size}.c')
+            if not os.path.exists(path):
+                with open(path, 'w') as out:
+                    ProgramGenerator(shape).write(out, size)
+            base = None
+            for jobs in jobs_list:
+                stats = run_frontend(args.bin, path, args.repeat, jobs)
+                stats['shape'] = shape
+                total_s = max(stats['total_ms'], 1e-3) / 1000
+                base = base or total_s
+                mem = stats['token_bytes'] + stats['lexeme_bytes'] + stats['node_bytes']
+                last = prev.get(jobs)
+                print(f"{shape:<12}{int(stats['bytes']):>12}{jobs:>5}{int(stats['tokens']):>12}{int(stats['nodes']):>12}"
+                      f"{stats['lex_ms']:>10.2f}{stats['parse_ms']:>10.2f}{stats['total_ms']:>10.2f}"
+                      f"{stats['bytes'] / total_s / 1e6:>8.1f}{stats['nodes'] / total_s / 1e6:>10.2f}"
+                      f"{base / total_s:>8.2f}{mem / max(stats['nodes'], 1):>8.0f}{stats['peak_rss_kb'] / 1024:>8.1f}"
+                      f"{fmt_slope(slope(last, stats, 'lex_ms')):>7}{fmt_slope(slope(last, stats, 'parse_ms')):>8}"
+                      f"{fmt_slope(slope(last, stats, 'total_ms')):>8}")
+                results.append(stats)
+                prev[jobs] = stats
+            if not args.workdir:
+                os.remove(path)
+
+    print(f"\nlex k / parse k / total k: log-log slope of time vs. size against the previous size at the same jobs; "
+          f"'!' marks slope > {NONLINEAR_SLOPE} (non-linear growth).")
+    if args.json:
+        with open(args.json, 'a') as out:
+            for stats in results:
+                out.write(json.dumps(stats) + '\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""
+预解析（--lazy）基准
+
+生成一个定义了大量函数、但只调用其中少数几个的库式脚本，
+分别以默认模式和 --lazy 模式运行，比较启动耗时、峰值内存和语法树节点数。
+
+用法：
+    gcc -O2 -o c_interpreter c_interpreter.c
+    python bench/bench_lazy.py --functions 10000 --calls 3
+"""
+
+import argparse
+import os
+import subprocess
+import tempfile
+import time
+
+
+def library_script(functions, calls):
+    """每个函数体含局部变量、if 和 for；末尾只调用前 calls 个函数"""
+    parts = ['int total = 0;\n']
+    for k in range(functions):
+        parts.append(
+            f'def lib{k}(int a, int b) {{\n'
+            f'    int t = a * {k % 7 + 1} + b;\n'
+            f'    int u = t - a + (b - {k % 5}) * 3;\n'
+            f'    if (t > u) {{\n'
+            f'        t = t - u;\n'
+            f'    }} else {{\n'
+            f'        t = u - t + 1;\n'
+            f'    }}\n'
+            f'    for (int i = 0; i < 3; i = i + 1) {{\n'
+            f'        t = t + i * {k % 3 + 1};\n'
+            f'    }}\n'
+            f'    return t + u;\n'
+            f'}}\n')
+    for k in range(calls):
+        parts.append(f'total = total + lib{k}({k}, {k + 1});\n')
+    parts.append('print(total);\n')
+    return ''.join(parts)
+
+
+def run(cmd):
+    """运行一次，返回（输出，耗时秒，峰值 RSS KB）"""
+    start = time.perf_counter()
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, text=True)
+    out = proc.stdout.read()
+    _, status, usage = os.wait4(proc.pid, 0)
+    elapsed = time.perf_counter() - start
+    if status != 0:
+        raise SystemExit(f'{" ".join(cmd)} failed: {out}')
+    return out, elapsed, usage.ru_maxrss
+
+
+def frontend_stats(binary, flags, path):
+    out = subprocess.run([binary] + flags + ['--bench-frontend', path],
+                         check=True, capture_output=True, text=True).stdout
+    return {k: float(v) for k, v in (field.split('=', 1) for field in out.split())}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Benchmark lazy parsing of def bodies')
+    parser.add_argument('--bin', default='./c_interpreter', help='interpreter binary (default ./c_interpreter)')
+    parser.add_argument('--functions', type=int, default=10000)
+    parser.add_argument('--calls', type=int, default=3)
+    parser.add_argument('--repeat', type=int, default=5, help='runs per mode, fastest is kept')
+    args = parser.parse_args()
+
+    fd, path = tempfile.mkstemp(suffix='.c')
+    with os.fdopen(fd, 'w') as out:
+        out.write(library_script(args.functions, args.calls))
+    try:
+        print(f'{args.functions} functions, {args.calls} called, {os.path.getsize(path)} bytes\n')
+        print(f"{'mode':<8}{'run ms':>10}{'RSS MB':>10}{'parse ms':>10}{'nodes':>10}{'node MB':>10}")
+        outputs = set()
+        for name, flags in (('eager', []), ('lazy', ['--lazy'])):
+            best = None
+            for _ in range(args.repeat):
+                out, elapsed, rss = run([args.bin] + flags + [path])
+                outputs.add(out)
+                if best is None or elapsed < best[0]:
+                    best = (elapsed, rss)
+            stats = frontend_stats(args.bin, flags, path)
+            print(f"{name:<8}{best[0] * 1000:>10.2f}{best[1] / 1024:>10.1f}{stats['parse_ms']:>10.2f}"
+                  f"{int(stats['nodes']):>10}{stats['node_bytes'] / 2**20:>10.2f}")
+        if len(outputs) != 1:
+            raise SystemExit('eager and lazy runs printed different output')
+    finally:
+        os.remove(path)
+
+
+if __name__ == '__main__':
+    main()
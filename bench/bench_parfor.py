@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""
+parfor 扩展性基准
+
+计算密集的 parfor 求和循环，分别用 1..N 个线程运行（--threads），
+报告耗时、加速比和并行效率，并与等价的串行 for 循环比较结果。
+
+用法：
+    gcc -O2 -o c_interpreter c_interpreter.c -pthread
+    python bench/bench_parfor.py --iterations 20000 --max-threads 8
+"""
+
+import argparse
+import os
+import subprocess
+import tempfile
+import time
+
+WORK = '''def work(int x) {
+    int acc = 0;
+    for (int k = 0; k < %(inner)d; k = k + 1) {
+        acc = acc + x * k - acc / 3;
+    }
+    return acc;
+}
+int n = %(iterations)d;
+int total = 0;
+'''
+
+PARFOR = WORK + '''parfor (int i = 0; i < n; i = i + 1) sum(total) {
+    total = total + work(i);
+}
+print(total);
+'''
+
+SERIAL = WORK + '''for (int i = 0; i < n; i = i + 1) {
+    total = total + work(i);
+}
+print(total);
+'''
+
+
+def run(cmd, repeat):
+    best = None
+    out = None
+    for _ in range(repeat):
+        start = time.perf_counter()
+        out = subprocess.run(cmd, check=True, capture_output=True, text=True).stdout
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return out, best
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Scaling benchmark for parfor')
+    parser.add_argument('--bin', default='./c_interpreter', help='interpreter binary (default ./c_interpreter)')
+    parser.add_argument('--iterations', type=int, default=20000)
+    parser.add_argument('--inner', type=int, default=200, help='work per iteration')
+    parser.add_argument('--max-threads', type=int, default=os.cpu_count() or 1)
+    parser.add_argument('--repeat', type=int, default=3, help='runs per point, fastest is kept')
+    args = parser.parse_args()
+
+    params = {'iterations': args.iterations, 'inner': args.inner}
+    paths = {}
+    for name, template in (('parfor', PARFOR), ('serial', SERIAL)):
+        fd, paths[name] = tempfile.mkstemp(suffix='.c')
+        with os.fdopen(fd, 'w') as out:
+            out.write(template % params)
+    try:
+        expected, serial = run([args.bin, paths['serial']], args.repeat)
+        print(f"{args.iterations} iterations x {args.inner} inner steps, {os.cpu_count()} CPUs\n")
+        print(f"{'threads':>8}{'ms':>10}{'speedup':>9}{'efficiency':>12}")
+        print(f"{'for':>8}{serial * 1000:>10.1f}{1.0:>9.2f}{'':>12}")
+        threads = 1
+        base = None
+        while threads <= args.max_threads:
+            out, elapsed = run([args.bin, '--threads', str(threads), paths['parfor']], args.repeat)
+            if out != expected:
+                raise SystemExit(f'parfor with {threads} threads printed {out!r}, serial for printed {expected!r}')
+            base = base or elapsed
+            print(f"{threads:>8}{elapsed * 1000:>10.1f}{base / elapsed:>9.2f}{base / elapsed / threads:>12.2f}")
+            threads = threads * 2 if threads * 2 <= args.max_threads or threads == args.max_threads else args.max_threads
+    finally:
+        for path in paths.values():
+            os.remove(path)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""
+执行轨迹开销基准
+
+分别编译记录轨迹的解释器和用 -DCI_NO_TRACE 去掉轨迹的解释器，
+运行同样的循环、分支和调用密集的脚本，用两者的耗时差除以记录的事件数，
+报告每个事件的平均开销。事件数取自脚本末尾故意触发的错误所输出的轨迹。
+
+用法：
+    python bench/bench_trace.py --iterations 2000000
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SCRIPT = '''def step(int a, int b) {
+    int c = a * 2 + b;
+    if (c > 1000) {
+        c = c / 3;
+    }
+    return c;
+}
+int acc = 1;
+for (int i = 0; i < %(n)d; i = i + 1) {
+    acc = step(acc, i / 100);
+    if (acc > 5000) {
+        acc = 1;
+    }
+}
+print(acc);
+'''
+
+
+def build(source, output, flags):
+    subprocess.run(['gcc', '-O2', '-pthread', *flags, '-o', output, source], check=True)
+
+
+def run(binary, path, repeat):
+    best = None
+    for _ in range(repeat):
+        start = time.perf_counter()
+        subprocess.run([binary, path], check=True, capture_output=True)
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return best
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Per-event cost of the execution trace')
+    parser.add_argument('--source', default=os.path.join(ROOT, 'c_interpreter.c'), help='interpreter source')
+    parser.add_argument('--iterations', type=int, default=2000000, help='loop iterations in the script')
+    parser.add_argument('--repeat', type=int, default=5, help='runs per build, fastest is kept')
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        traced = os.path.join(tmp, 'traced')
+        untraced = os.path.join(tmp, 'untraced')
+        build(args.source, traced, [])
+        build(args.source, untraced, ['-DCI_NO_TRACE'])
+
+        code = SCRIPT % {'n': args.iterations}
+        path = os.path.join(tmp, 'script.c')
+        with open(path, 'w') as out:
+            out.write(code)
+
+        # 末尾引用未定义的变量，从出错时输出的轨迹头中读出事件总数
+        failing = os.path.join(tmp, 'failing.c')
+        with open(failing, 'w') as out:
+            out.write(code + 'print(undefined);\n')
+        stderr = subprocess.run([traced, '--trace', '1', failing], capture_output=True, text=True).stderr
+        match = re.search(r'of (\d+) events', stderr)
+        if match is None:
+            raise SystemExit(f'could not read the event count: {stderr!r}')
+        events = int(match.group(1))
+
+        traced_time = run(traced, path, args.repeat)
+        untraced_time = run(untraced, path, args.repeat)
+
+    overhead = traced_time - untraced_time
+    print(f"{events} events, traced {traced_time * 1000:.1f} ms, untraced {untraced_time * 1000:.1f} ms")
+    print(f"overhead {overhead / untraced_time * 100:.1f}%, {max(overhead, 0) * 1e9 / events:.2f} ns/event")
+
+
+if __name__ == '__main__':
+    main()
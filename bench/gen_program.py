@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""
+大规模测试程序生成器
+
+生成可以被 c_interpreter 和 mini_interpreter.py 正常解析、执行的程序，
+用于测量前端（词法分析、语法分析）随输入规模的扩展性。
+
+程序形状：
+- functions:   大量小函数定义，以及对它们的调用
+- nested:      深层嵌套的 if / for
+- expressions: 很长的算术表达式
+- identifiers: 很长的标识符
+- mixed:       以上几种轮流出现
+
+用法：
+    python bench/gen_program.py --size 4M --shape mixed -o big.c
+"""
+
+import argparse
+import random
+import sys
+
+SHAPES = ('functions', 'nested', 'expressions', 'identifiers', 'mixed')
+
+
+def parse_size(text):
+    """解析 1K / 16M / 1G 形式的大小"""
+    text = text.strip().upper()
+    units = {'K': 1024, 'M': 1024 ** 2, 'G': 1024 ** 3}
+    if text and text[-1] in units:
+        return int(float(text[:-1]) * units[text[-1]])
+    return int(text)
+
+
+class ProgramGenerator:
+    def __init__(self, shape='mixed', seed=1, depth=8, expr_terms=64, ident_len=200):
+        self.shape = shape
+        self.rng = random.Random(seed)
+        self.depth = depth
+        self.expr_terms = expr_terms
+        self.ident_len = ident_len
+        self.function_index = 0
+
+    def expression(self, names, terms):
+        """生成只含 + - * 和括号的表达式，避免除零"""
+        parts = []
+        for k in range(terms):
+            name = self.rng.choice(names)
+            const = self.rng.randint(1, 9)
+            form = self.rng.randint(0, 2)
+            if form == 0:
+                term = f'{name} * {const}'
+            elif form == 1:
+                term = f'({name} - {const})'
+            else:
+                term = f'{const}'
+            if k:
+                parts.append(self.rng.choice(('+', '-')))
+            parts.append(term)
+        return ' '.join(parts)
+
+    def long_name(self, index):
+        prefix = f'v{index}_'
+        return prefix + 'x' * max(1, self.ident_len - len(prefix))
+
+    def nested_block(self, level, indent):
+        pad = '    ' * indent
+        if level == 0:
+            return f'{pad}t = t + 1;\n'
+        inner = self.nested_block(level - 1, indent + 1)
+        if level % 2 == 0:
+            return (f'{pad}if (a < b + {level}) {{\n{inner}{pad}}} else {{\n'
+                    f'{pad}    t = t - 1;\n{pad}}}\n')
+        var = f'i{level}'
+        return (f'{pad}for (int {var} = 0; {var} < 1; {var} = {var} + 1) {{\n'
+                f'{inner}{pad}}}\n')
+
+    def function(self, kind):
+        """生成一个函数定义和一条调用它的顶层语句"""
+        name = f'f{self.function_index}'
+        self.function_index += 1
+        lines = [f'def {name}(int a, int b) {{\n']
+        if kind == 'functions':
+            lines.append('    int t = a + b;\n')
+            lines.append(f'    t = t * {self.rng.randint(2, 9)} - a;\n')
+            lines.append('    if (t > b) {\n        t = t - b;\n    }\n')
+        elif kind == 'nested':
+            lines.append('    int t = 0;\n')
+            lines.append(self.nested_block(self.depth, 1))
+        elif kind == 'expressions':
+            lines.append(f'    int t = {self.expression(["a", "b"], self.expr_terms)};\n')
+        elif kind == 'identifiers':
+            names = [self.long_name(k) for k in range(4)]
+            lines.append(f'    int {names[0]} = a;\n')
+            lines.append(f'    int {names[1]} = b;\n')
+            lines.append(f'    int {names[2]} = {names[0]} + {names[1]};\n')
+            lines.append(f'    int {names[3]} = {names[2]} * 2 - {names[0]};\n')
+            lines.append(f'    int t = {names[3]};\n')
+        lines.append('    return t;\n}\n')
+        lines.append(f'r = {name}({self.rng.randint(0, 9)}, {self.rng.randint(0, 9)});\n')
+        return ''.join(lines)
+
+    def write(self, out, size):
+        """写出至少 size 字节的程序，返回实际字节数"""
+        header = '// generated by bench/gen_program.py\nint r = 0;\n'
+        out.write(header)
+        written = len(header)
+        kinds = SHAPES[:-1]
+        step = 0
+        chunk = []
+        chunk_size = 0
+        while written + chunk_size < size:
+            kind = self.shape if self.shape != 'mixed' else kinds[step % len(kinds)]
+            text = self.function(kind)
+            chunk.append(text)
+            chunk_size += len(text)
+            step += 1
+            if chunk_size > 1 << 20:
+                out.write(''.join(chunk))
+                written += chunk_size
+                chunk = []
+                chunk_size = 0
+        footer = 'print(r);\n'
+        chunk.append(footer)
+        chunk_size += len(footer)
+        out.write(''.join(chunk))
+        return written + chunk_size
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate large valid programs for c_interpreter')
+    parser.add_argument('--size', default='64K', help='target size, e.g. 1K, 16M (default 64K)')
+    parser.add_argument('--shape', default='mixed', choices=SHAPES)
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--depth', type=int, default=8, help='if/for nesting depth for the nested shape')
+    parser.add_argument('--expr-terms', type=int, default=64, help='terms per expression for the expressions shape')
+    parser.add_argument('--ident-len', type=int, default=200, help='identifier length for the identifiers shape')
+    parser.add_argument('-o', '--output', help='output file (default stdout)')
+    args = parser.parse_args()
+
+    gen = ProgramGenerator(args.shape, args.seed, args.depth, args.expr_terms, args.ident_len)
+    size = parse_size(args.size)
+    if args.output:
+        with open(args.output, 'w') as out:
+            gen.write(out, size)
+    else:
+        gen.write(sys.stdout, size)
+
+
+if __name__ == '__main__':
+    main()
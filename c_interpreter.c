@@ -1,8 +1,43 @@
+// pthread_getattr_np 用于读取线程的栈范围
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#include <time.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <io.h>
+#include <malloc.h>
+#define isatty _isatty
+#define fileno _fileno
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#endif
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
 
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+// x86 上用 GCC/Clang 编译时提供 AVX2 数组内核，运行时按 CPU 选择
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2_KERNELS 1
+#endif
 
 // 标记类型
 typedef enum {
@@ -13,12 +48,15 @@ typedef enum {
     RPAREN,
     LBRACE,
     RBRACE,
+    LBRACKET,
+    RBRACKET,
     SEMICOLON,
     COMMA,
     INT,
     IF,
     ELSE,
     FOR,
+    PARFOR,
     DEF,
     PRINT,
     INPUT,
@@ -27,9 +65,11 @@ typedef enum {
 } TokenType;
 
 // 标记结构体
-typedef struct {
+// value 指向词素存储区或静态字符串，不再限制标识符长度；line 是所在行号
+typedef struct Token {
     TokenType type;
-    char value[256];
+    int line;
+    const char *value;
 } Token;
 
 // 抽象语法树节点类型
@@ -39,6 +79,7 @@ typedef enum {
     NODE_ASSIGNMENT,
     NODE_IF_STMT,
     NODE_FOR_STMT,
+    NODE_PARFOR_STMT,
     NODE_FUNCTION_DEF,
     NODE_FUNCTION_CALL,
     NODE_FUNCTION_CALL_EXPR,
@@ -47,14 +88,18 @@ typedef enum {
     NODE_BINARY_OP,
     NODE_NUMBER,
     NODE_IDENTIFIER,
-    NODE_RETURN_STMT
+    NODE_RETURN_STMT,
+    NODE_ARRAY_DECL,
+    NODE_INDEX_EXPR,
+    NODE_INDEX_ASSIGN
 } NodeType;
 
 // 抽象语法树节点结构体
 typedef struct Node {
     NodeType type;
-    char name[256];
+    const char *name;
     int value;
+    int line;
     struct Node *left;
     struct Node *right;
     struct Node *body;
@@ -63,178 +108,557 @@ typedef struct Node {
     struct Node *params;
     struct Node *args;
     struct Node *return_expr;
+    struct Token *lazy_tokens;
 } Node;
 
+// 数组：连续存储，按 64 字节对齐，便于向量化
+typedef struct {
+    int *data;
+    int length;
+} Array;
+
+struct Scope;
+
+// 内置函数：直接接收参数语法树，不创建作用域
+typedef int (*BuiltinFunc)(Node *args, struct Scope *scope);
+
+// 宿主登记的原生函数：按源码顺序接收求值后的参数
+typedef int (*NativeFunc)(int *args, int count);
+
 // 函数结构体
 typedef struct {
-    char name[256];
+    const char *name;
     Node *params;
     Node *body;
     Node *return_expr;
+    Node *def;
+    BuiltinFunc builtin;
+    int writes_array;
+    NativeFunc native;
 } Function;
 
 // 作用域结构体
+// 变量名指向语法树中的名字，不做拷贝；数组变量的 arrays 项非空
 typedef struct Scope {
-    char variables[100][256];
+    const char *variables[100];
     int values[100];
     int count;
     struct Scope *parent;
+    Array *arrays[100];
 } Scope;
 
+// 用户函数调用的栈帧，按调用顺序链接，出错时据此释放被跳过的作用域中的数组
+typedef struct Frame {
+    Scope *scope;
+    struct Frame *next;
+} Frame;
+
+// 顶层单元：一个 def 块或一条顶层语句，text 指向源码中的对应片段
+typedef struct {
+    const char *text;
+    int length;
+    int line;
+    unsigned int hash;
+    Node *ast;
+    Node **defs;
+    int def_count;
+} Unit;
+
+// 内存区：按块分配、整体释放的简单分配器，用于词素和语法树节点
+// 每块开头保存上一块的地址，释放时沿链表逐块释放
+typedef struct {
+    char *block;
+    size_t used;
+    size_t size;
+    size_t total;
+    long long *allocated;
+} Arena;
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+// 前端统计：并行前端把各线程的结果汇总到这里
+typedef struct {
+    long tokens;
+    long nodes;
+    size_t token_bytes;
+    size_t lexeme_bytes;
+    size_t node_bytes;
+} FrontendStats;
+
+// 内存统计：--stats 在退出时输出，嵌入接口用 ci_get_memory_stats 查询
+// 词法、语法分析和函数表按累计分配的字节数统计（实例销毁、内存释放时不扣减），数组按当前占用和峰值统计
+typedef struct {
+    long long tokens;
+    long long nodes;
+    long long lexer_bytes;
+    long long parser_bytes;
+    long long function_bytes;
+    long long scope_bytes;
+    long long array_bytes;
+    long long peak_array_bytes;
+    long long peak_depth;
+    long long peak_rss_kb;
+} MemoryStats;
+
+// parfor 归约类型
+typedef enum {
+    REDUCE_NONE,
+    REDUCE_SUM,
+    REDUCE_MIN,
+    REDUCE_MAX
+} ReduceKind;
+
+#define ERROR_MESSAGE_SIZE 512
+
+// 可增长的文本缓冲区，嵌入时用于收集 print 的输出
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} TextBuffer;
+
+// 执行轨迹：每个线程一个定长环形缓冲区，一直开启
+// 每个事件压缩为 8 字节：低 8 位是事件类型，8-31 位是行号，高 32 位是附加数据
+// （语句为节点类型，函数进入/返回为函数表下标，分支为 1 表示走 then、0 表示走 else）
+typedef enum {
+    TRACE_STATEMENT = 1,
+    TRACE_ENTER,
+    TRACE_EXIT,
+    TRACE_BRANCH
+} TraceKind;
+
+#define TRACE_SIZE 4096
+
+typedef struct {
+    unsigned long long events[TRACE_SIZE];
+    unsigned long long count;
+} TraceRing;
+
 // 全局变量
-Token tokens[1000];
-int token_count = 0;
-int current_token = 0;
-Function functions[100];
+// 词法、语法分析的状态按线程独立，并行前端的每个线程有自己的标记数组和内存区
+THREAD_LOCAL Token *tokens = NULL;
+THREAD_LOCAL int token_count = 0;
+THREAD_LOCAL int token_capacity = 0;
+THREAD_LOCAL int current_token = 0;
+THREAD_LOCAL int lexer_line = 1;
+THREAD_LOCAL int tokens_pinned = 0;
+THREAD_LOCAL int register_defs = 1;
+int lazy_parse = 0;
+int frontend_jobs = 1;
+int parfor_threads = 0;
+Function *functions = NULL;
 int function_count = 0;
-Scope global_scope = {{}, {}, 0, NULL};
+int function_capacity = 0;
+int *function_slots = NULL;
+int function_slot_count = 0;
+Scope global_scope = {{0}, {0}, 0, NULL, {0}};
+// 各线程的计数汇总到 memory_stats，用原子操作更新
+MemoryStats memory_stats = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+THREAD_LOCAL Arena lexeme_arena = {NULL, 0, 0, 0, &memory_stats.lexer_bytes};
+THREAD_LOCAL Arena node_arena = {NULL, 0, 0, 0, &memory_stats.parser_bytes};
+THREAD_LOCAL long node_count = 0;
+THREAD_LOCAL long node_count_reported = 0;
+// 当前线程上用户函数调用的嵌套深度
+THREAD_LOCAL int call_depth = 0;
+// 当前线程最内层的调用栈帧；出错跳转前释放 unwind_mark 之上各栈帧中的数组，
+// 捕获错误后继续运行的位置（REPL、嵌入接口、parfor 任务等）在 setjmp 前把它设为当时的 frame_top
+THREAD_LOCAL Frame *frame_top = NULL;
+THREAD_LOCAL Frame *unwind_mark = NULL;
+THREAD_LOCAL jmp_buf *error_jmp = NULL;
+THREAD_LOCAL char *error_message = NULL;
+// 设置 output_buffer 时 print 写入该缓冲区；设置 input_hook 时 input() 从它取值，返回 0 表示没有输入
+THREAD_LOCAL TextBuffer *output_buffer = NULL;
+int (*input_hook)(int *value) = NULL;
+// 步数预算：每条语句、每次循环回边和每次函数调用记一步，预算用完时调用 step_hook
+// （未设置时不限制）；step_limit 是命令行 --step-limit 给出的上限
+THREAD_LOCAL long long step_budget = LLONG_MAX;
+THREAD_LOCAL void (*step_hook)(void) = NULL;
+long long step_limit = 0;
+// 为真时 parfor 在调用线程上串行执行，循环体照常计步（调度器的协程在循环体内也能按时间片让出）
+THREAD_LOCAL int parfor_inline = 0;
+// 设置 stack_limit 时，函数调用前检查栈是否越过该地址，越过时报 Stack overflow 而不是崩溃
+THREAD_LOCAL char *stack_limit = NULL;
+// 当前线程的栈范围只计算一次（Linux 上 pthread_getattr_np 要读 /proc/self/maps），之后直接复用
+THREAD_LOCAL char *thread_stack_limit = NULL;
+THREAD_LOCAL int thread_stack_known = 0;
+// 栈底留给报错路径（格式化错误信息、输出轨迹）的余量
+#define STACK_MARGIN (64 * 1024)
+THREAD_LOCAL TraceRing trace_ring;
+// 收到信号时导出的轨迹（主线程的缓冲区）和导出文件路径
+TraceRing *trace_signal_ring = NULL;
+char trace_dump_path[64] = "";
+// 出错时输出的轨迹事件数，0 表示不输出
+int trace_print_limit = 64;
 
-// 词法分析器
-void tokenize(const char *code) {
-    int i = 0;
-    int j = 0;
+// 记录一个轨迹事件：只写一个 8 字节的槽位；用 -DCI_NO_TRACE 编译时不记录（供基准对比）
+#ifdef CI_NO_TRACE
+#define TRACE(kind, line, data) ((void)0)
+#else
+#define TRACE(kind, line, data) \
+    (trace_ring.events[trace_ring.count++ & (TRACE_SIZE - 1)] = \
+        (unsigned long long)(kind) | ((unsigned long long)((line) & 0xffffff) << 8) | \
+        ((unsigned long long)(unsigned int)(data) << 32))
+#endif
+
+void print_trace();
+
+// 把已经报告过的错误交给外层处理：跳回 error_jmp，否则退出进程
+void unwind_frames(Frame *mark);
+
+_Noreturn void rethrow_error() {
+    if (error_jmp != NULL) {
+        unwind_frames(unwind_mark);
+        longjmp(*error_jmp, 1);
+    }
+    print_trace();
+    exit(1);
+}
+
+// 报告错误；设置了 error_message 时写入该缓冲区而不输出
+_Noreturn void fatal_error(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (error_message != NULL) {
+        vsnprintf(error_message, ERROR_MESSAGE_SIZE, format, args);
+    } else {
+        vprintf(format, args);
+    }
+    va_end(args);
+    rethrow_error();
+}
+
+// 向文本缓冲区追加格式化文本，内存不足时返回 0
+int buffer_vprintf(TextBuffer *buffer, const char *format, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+    if (length > 0) {
+        if (buffer->length + length + 1 > buffer->capacity) {
+            size_t capacity = buffer->capacity ? buffer->capacity : 256;
+            while (buffer->length + length + 1 > capacity) {
+                capacity *= 2;
+            }
+            char *data = (char *)realloc(buffer->data, capacity);
+            if (data == NULL) {
+                return 0;
+            }
+            buffer->data = data;
+            buffer->capacity = capacity;
+        }
+        vsnprintf(buffer->data + buffer->length, length + 1, format, args);
+        buffer->length += length;
+    }
+    return 1;
+}
+
+void buffer_printf(TextBuffer *buffer, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    buffer_vprintf(buffer, format, args);
+    va_end(args);
+}
+
+// 输出文本：写入 output_buffer，未设置时写到标准输出
+void write_output(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (output_buffer == NULL) {
+        vprintf(format, args);
+        va_end(args);
+        return;
+    }
+    int ok = buffer_vprintf(output_buffer, format, args);
+    va_end(args);
+    if (!ok) {
+        fatal_error("Error: Out of memory");
+    }
+}
+
+// 记一步；预算用完时交给 step_exhausted 处理
+#define COUNT_STEP() do { if (--step_budget <= 0) step_exhausted(); } while (0)
+
+void step_exhausted() {
+    if (step_hook != NULL) {
+        step_hook();
+    } else {
+        step_budget = LLONG_MAX;
+    }
+}
+
+// --step-limit：超过上限时报错
+void step_limit_exceeded() {
+    fatal_error("Error: Step limit exceeded (%lld steps)", step_limit);
+}
+
+// 统计计数器；多个线程可能同时更新
+#define STAT_ADD(field, n) __atomic_fetch_add(&memory_stats.field, (long long)(n), __ATOMIC_RELAXED)
+
+void update_peak(long long *peak, long long value) {
+    long long current = __atomic_load_n(peak, __ATOMIC_RELAXED);
+    while (value > current &&
+           !__atomic_compare_exchange_n(peak, &current, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// 进入用户函数调用：检查栈深度，把栈帧压入 frame_top，记录嵌套深度的峰值
+void enter_frame(Frame *frame) {
+    if (stack_limit != NULL && (char *)frame < stack_limit) {
+        fatal_error("Error: Stack overflow");
+    }
+    frame->next = frame_top;
+    frame_top = frame;
+    update_peak(&memory_stats.peak_depth, ++call_depth);
+}
+
+// 按当前线程的栈范围设置 stack_limit；Linux 读取线程的实际栈范围，
+// 其他 Unix 只在主线程上按 RLIMIT_STACK 从当前位置估算，取不到时不检查；结果按线程缓存
+void set_stack_limit(int main_thread) {
+    if (thread_stack_known) {
+        stack_limit = thread_stack_limit;
+        return;
+    }
+#if defined(__linux__)
+    (void)main_thread;
+    pthread_attr_t attr;
+    void *address;
+    size_t size;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        if (pthread_attr_getstack(&attr, &address, &size) == 0 && size > 2 * STACK_MARGIN) {
+            thread_stack_limit = (char *)address + STACK_MARGIN;
+        }
+        pthread_attr_destroy(&attr);
+    }
+#elif !defined(_WIN32)
+    struct rlimit limit;
+    char here;
+    if (main_thread && getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY &&
+        limit.rlim_cur > 2 * STACK_MARGIN) {
+        thread_stack_limit = &here - limit.rlim_cur + STACK_MARGIN;
+    }
+#else
+    (void)main_thread;
+#endif
+    thread_stack_known = 1;
+    stack_limit = thread_stack_limit;
+}
+
+// 块头：上一块的地址，占 8 字节以保持对齐
+#define ARENA_HEADER_SIZE 8
+
+// 从内存区分配 size 字节，按 8 字节对齐
+void *arena_alloc(Arena *arena, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+    if (arena->block == NULL || arena->used + size > arena->size) {
+        size_t block_size = size + ARENA_HEADER_SIZE > ARENA_BLOCK_SIZE ? size + ARENA_HEADER_SIZE : ARENA_BLOCK_SIZE;
+        char *block = (char *)malloc(block_size);
+        if (block == NULL) {
+            fatal_error("Error: Out of memory");
+        }
+        *(char **)block = arena->block;
+        arena->block = block;
+        arena->used = ARENA_HEADER_SIZE;
+        arena->size = block_size;
+        arena->total += block_size;
+        __atomic_fetch_add(arena->allocated, (long long)block_size, __ATOMIC_RELAXED);
+    }
+    void *ptr = arena->block + arena->used;
+    arena->used += size;
+    return ptr;
+}
+
+// 释放内存区的全部块；total 和分配统计是累计值，保持不变
+void arena_free(Arena *arena) {
+    while (arena->block != NULL) {
+        char *previous = *(char **)arena->block;
+        free(arena->block);
+        arena->block = previous;
+    }
+    arena->used = 0;
+    arena->size = 0;
+}
+
+// 保存一个词素，返回以 '\0' 结尾的副本
+const char *save_lexeme(const char *start, int length) {
+    char *text = (char *)arena_alloc(&lexeme_arena, length + 1);
+    memcpy(text, start, length);
+    text[length] = '\0';
+    return text;
+}
+
+// 追加一个标记，必要时扩容标记数组
+void add_token(TokenType type, const char *value) {
+    if (token_count >= token_capacity) {
+        int old_capacity = token_capacity;
+        token_capacity = token_capacity ? token_capacity * 2 : 1024;
+        tokens = (Token *)realloc(tokens, sizeof(Token) * token_capacity);
+        if (tokens == NULL) {
+            fatal_error("Error: Out of memory");
+        }
+        STAT_ADD(lexer_bytes, sizeof(Token) * (token_capacity - old_capacity));
+    }
+    tokens[token_count].type = type;
+    tokens[token_count].line = lexer_line;
+    tokens[token_count].value = value;
+    token_count++;
+}
+
+// 释放当前线程的标记数组；仍被延迟解析的函数体引用时留给它们
+void release_tokens() {
+    if (!tokens_pinned) {
+        free(tokens);
+    }
+    tokens = NULL;
+    token_capacity = 0;
+    token_count = 0;
+    current_token = 0;
+    tokens_pinned = 0;
+}
+
+// 关键字表
+const char *keywords[] = {"int", "if", "else", "for", "parfor", "def", "print", "input", "return"};
+TokenType keyword_types[] = {INT, IF, ELSE, FOR, PARFOR, DEF, PRINT, INPUT, RETURN};
+#define KEYWORD_COUNT (int)(sizeof(keywords) / sizeof(keywords[0]))
+
+// 词法分析器，处理 code 的前 length 个字符，code 的第一行是源文件的第 first_line 行
+// 每次调用都从头填充标记数组，已生成的语法树只引用词素存储区，不受影响
+void tokenize_text(const char *code, long length, int first_line) {
+    long i = 0;
+    long start = 0;
     char current_char;
     
-    while ((current_char = code[i]) != '\0') {
+    // 当前标记数组仍被延迟解析的函数体引用时，改用新数组
+    if (tokens_pinned) {
+        tokens = NULL;
+        token_capacity = 0;
+        tokens_pinned = 0;
+    }
+    token_count = 0;
+    current_token = 0;
+    lexer_line = first_line;
+    
+    while (i < length && (current_char = code[i]) != '\0') {
         // 跳过空白字符
-        if (isspace(current_char)) {
+        if (isspace((unsigned char)current_char)) {
+            if (current_char == '\n') {
+                lexer_line++;
+            }
             i++;
             continue;
         }
         
         // 处理注释
-        if (current_char == '/' && code[i+1] == '/') {
-            while (code[i] != '\n' && code[i] != '\0') {
+        if (current_char == '/' && i + 1 < length && code[i+1] == '/') {
+            while (i < length && code[i] != '\n') {
                 i++;
             }
             continue;
         }
         
         // 处理数字
-        if (isdigit(current_char)) {
-            j = 0;
-            while (isdigit(code[i])) {
-                tokens[token_count].value[j++] = code[i++];
-            }
-            tokens[token_count].value[j] = '\0';
-            tokens[token_count].type = NUMBER;
-            token_count++;
+        if (isdigit((unsigned char)current_char)) {
+            start = i;
+            while (i < length && isdigit((unsigned char)code[i])) {
+                i++;
+            }
+            add_token(NUMBER, save_lexeme(code + start, i - start));
             continue;
         }
         
         // 处理标识符和关键字
-        if (isalpha(current_char) || current_char == '_') {
-            j = 0;
-            while (isalnum(code[i]) || code[i] == '_') {
-                tokens[token_count].value[j++] = code[i++];
+        if (isalpha((unsigned char)current_char) || current_char == '_') {
+            start = i;
+            while (i < length && (isalnum((unsigned char)code[i]) || code[i] == '_')) {
+                i++;
             }
-            tokens[token_count].value[j] = '\0';
             
             // 检查是否是关键字
-            if (strcmp(tokens[token_count].value, "int") == 0) {
-                tokens[token_count].type = INT;
-            } else if (strcmp(tokens[token_count].value, "if") == 0) {
-                tokens[token_count].type = IF;
-            } else if (strcmp(tokens[token_count].value, "else") == 0) {
-                tokens[token_count].type = ELSE;
-            } else if (strcmp(tokens[token_count].value, "for") == 0) {
-                tokens[token_count].type = FOR;
-            } else if (strcmp(tokens[token_count].value, "def") == 0) {
-                tokens[token_count].type = DEF;
-            } else if (strcmp(tokens[token_count].value, "print") == 0) {
-                tokens[token_count].type = PRINT;
-            } else if (strcmp(tokens[token_count].value, "input") == 0) {
-                tokens[token_count].type = INPUT;
-            } else if (strcmp(tokens[token_count].value, "return") == 0) {
-                tokens[token_count].type = RETURN;
+            int k;
+            for (k = 0; k < KEYWORD_COUNT; k++) {
+                if ((int)strlen(keywords[k]) == i - start && memcmp(keywords[k], code + start, i - start) == 0) {
+                    break;
+                }
+            }
+            if (k < KEYWORD_COUNT) {
+                add_token(keyword_types[k], keywords[k]);
             } else {
-                tokens[token_count].type = ID;
+                add_token(ID, save_lexeme(code + start, i - start));
             }
-            token_count++;
             continue;
         }
         
         // 处理操作符
         if (strchr("+-*/=<>!", current_char)) {
-            j = 0;
-            tokens[token_count].value[j++] = current_char;
+            const char *op = NULL;
+            int compound = i + 1 < length && code[i+1] == '=';
             
             // 处理复合操作符
-            if (current_char == '=' || current_char == '!' || current_char == '<' || current_char == '>') {
-                if (code[i+1] == '=') {
-                    tokens[token_count].value[j++] = code[++i];
-                }
+            switch (current_char) {
+                case '+': op = "+"; compound = 0; break;
+                case '-': op = "-"; compound = 0; break;
+                case '*': op = "*"; compound = 0; break;
+                case '/': op = "/"; compound = 0; break;
+                case '=': op = compound ? "==" : "="; break;
+                case '!': op = compound ? "!=" : "!"; break;
+                case '<': op = compound ? "<=" : "<"; break;
+                case '>': op = compound ? ">=" : ">"; break;
             }
             
-            tokens[token_count].value[j] = '\0';
-            tokens[token_count].type = OP;
-            token_count++;
-            i++;
+            add_token(OP, op);
+            i += compound ? 2 : 1;
             continue;
         }
         
         // 处理其他标记
         switch (current_char) {
             case '(':
-                tokens[token_count].type = LPAREN;
-                tokens[token_count].value[0] = '(';
-                tokens[token_count].value[1] = '\0';
-                token_count++;
-                i++;
+                add_token(LPAREN, "(");
                 break;
             case ')':
-                tokens[token_count].type = RPAREN;
-                tokens[token_count].value[0] = ')';
-                tokens[token_count].value[1] = '\0';
-                token_count++;
-                i++;
+                add_token(RPAREN, ")");
                 break;
             case '{':
-                tokens[token_count].type = LBRACE;
-                tokens[token_count].value[0] = '{';
-                tokens[token_count].value[1] = '\0';
-                token_count++;
-                i++;
+                add_token(LBRACE, "{");
                 break;
             case '}':
-                tokens[token_count].type = RBRACE;
-                tokens[token_count].value[0] = '}';
-                tokens[token_count].value[1] = '\0';
-                token_count++;
-                i++;
+                add_token(RBRACE, "}");
+                break;
+            case '[':
+                add_token(LBRACKET, "[");
+                break;
+            case ']':
+                add_token(RBRACKET, "]");
                 break;
             case ';':
-                tokens[token_count].type = SEMICOLON;
-                tokens[token_count].value[0] = ';';
-                tokens[token_count].value[1] = '\0';
-                token_count++;
-                i++;
+                add_token(SEMICOLON, ";");
                 break;
             case ',':
-                tokens[token_count].type = COMMA;
-                tokens[token_count].value[0] = ',';
-                tokens[token_count].value[1] = '\0';
-                token_count++;
-                i++;
+                add_token(COMMA, ",");
                 break;
             default:
-                i++;
                 break;
         }
+        i++;
     }
     
     // 添加结束标记
-    tokens[token_count].type = END;
-    tokens[token_count].value[0] = '\0';
-    token_count++;
+    add_token(END, "");
+    STAT_ADD(tokens, token_count);
+}
+
+// 对以 '\0' 结尾的源码做词法分析
+void tokenize(const char *code) {
+    tokenize_text(code, (long)strlen(code), 1);
 }
 
 // 创建新节点
 Node *create_node(NodeType type) {
-    Node *node = (Node *)malloc(sizeof(Node));
+    Node *node = (Node *)arena_alloc(&node_arena, sizeof(Node));
+    node_count++;
     node->type = type;
-    node->name[0] = '\0';
+    node->name = "";
     node->value = 0;
+    node->line = tokens != NULL ? tokens[current_token].line : 0;
     node->left = NULL;
     node->right = NULL;
     node->body = NULL;
@@ -243,12 +667,129 @@ Node *create_node(NodeType type) {
     node->params = NULL;
     node->args = NULL;
     node->return_expr = NULL;
+    node->lazy_tokens = NULL;
     return node;
 }
 
+// 把当前线程新建的语法树节点数计入 memory_stats；每次分析结束时调用，避免逐个节点做原子操作
+void report_node_count() {
+    STAT_ADD(nodes, node_count - node_count_reported);
+    node_count_reported = node_count;
+}
+
+// 函数名哈希（FNV-1a）
+unsigned int hash_name(const char *name) {
+    unsigned int hash = 2166136261u;
+    while (*name) {
+        hash = (hash ^ (unsigned char)*name++) * 16777619u;
+    }
+    return hash;
+}
+
+// 定长文本哈希，每次处理 8 字节
+unsigned int hash_bytes(const char *text, int length) {
+    unsigned long long hash = 0x9e3779b97f4a7c15ull ^ (unsigned long long)length;
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        unsigned long long word;
+        memcpy(&word, text + i, 8);
+        hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+        hash ^= hash >> 32;
+    }
+    for (; i < length; i++) {
+        hash = (hash ^ (unsigned char)text[i]) * 0x100000001b3ull;
+    }
+    hash ^= hash >> 29;
+    return (unsigned int)(hash ^ (hash >> 32));
+}
+
+// 在函数哈希表中查找名字对应的槽位；槽位内容为函数下标 + 1，0 表示空
+int *function_slot(const char *name) {
+    unsigned int mask = function_slot_count - 1;
+    unsigned int i = hash_name(name) & mask;
+    while (function_slots[i] != 0 && strcmp(functions[function_slots[i] - 1].name, name) != 0) {
+        i = (i + 1) & mask;
+    }
+    return &function_slots[i];
+}
+
+// 扩容函数哈希表并重新插入所有函数
+void grow_function_slots() {
+    free(function_slots);
+    STAT_ADD(function_bytes, sizeof(int) * (function_slot_count ? function_slot_count : 128));
+    function_slot_count = function_slot_count ? function_slot_count * 2 : 128;
+    function_slots = (int *)calloc(function_slot_count, sizeof(int));
+    if (function_slots == NULL) {
+        fatal_error("Error: Out of memory");
+    }
+    for (int i = 0; i < function_count; i++) {
+        *function_slot(functions[i].name) = i + 1;
+    }
+}
+
+// 清空函数表
+void reset_functions() {
+    function_count = 0;
+    if (function_slots != NULL) {
+        memset(function_slots, 0, sizeof(int) * function_slot_count);
+    }
+}
+
+// 取得名为 name 的函数表项，不存在时新建；同名函数重新定义时只替换该项
+Function *define_function(const char *name) {
+    if ((function_count + 1) * 2 > function_slot_count) {
+        grow_function_slots();
+    }
+    int *slot = function_slot(name);
+    Function *func;
+    if (*slot != 0) {
+        func = &functions[*slot - 1];
+    } else {
+        if (function_count >= function_capacity) {
+            int old_capacity = function_capacity;
+            function_capacity = function_capacity ? function_capacity * 2 : 64;
+            functions = (Function *)realloc(functions, sizeof(Function) * function_capacity);
+            if (functions == NULL) {
+                fatal_error("Error: Out of memory");
+            }
+            STAT_ADD(function_bytes, sizeof(Function) * (function_capacity - old_capacity));
+        }
+        func = &functions[function_count++];
+        *slot = function_count;
+    }
+    memset(func, 0, sizeof(Function));
+    func->name = name;
+    return func;
+}
+
+// 添加函数到函数列表
+void add_function(Node *def) {
+    Function *func = define_function(def->name);
+    func->params = def->params;
+    func->body = def->body;
+    func->return_expr = def->return_expr;
+    func->def = def;
+}
+
+// 登记内置函数；writes_array 表示会写入第一个参数指定的数组
+void add_builtin(const char *name, BuiltinFunc builtin, int writes_array) {
+    Function *func = define_function(name);
+    func->builtin = builtin;
+    func->writes_array = writes_array;
+}
+
+// 登记宿主提供的原生函数
+void add_native(const char *name, NativeFunc native) {
+    Function *func = define_function(name);
+    func->native = native;
+}
+
 // 解析表达式
 Node *parse_expression();
 
+// 计算表达式
+int evaluate(Node *node, Scope *scope);
+
 // 解释语句
 void interpret(Node *node, Scope *scope);
 
@@ -264,15 +805,12 @@ Node *parse_factor() {
         current_token++;
     } else if (tokens[current_token].type == ID) {
         node = create_node(NODE_IDENTIFIER);
-        strcpy(node->name, tokens[current_token].value);
+        node->name = tokens[current_token].value;
         current_token++;
         
         // 检查是否是函数调用表达式
         if (tokens[current_token].type == LPAREN) {
-            Node *call_node = create_node(NODE_FUNCTION_CALL_EXPR);
-            strcpy(call_node->name, node->name);
-            free(node);
-            node = call_node;
+            node->type = NODE_FUNCTION_CALL_EXPR;
             
             current_token++;
             if (tokens[current_token].type != RPAREN) {
@@ -286,8 +824,16 @@ Node *parse_factor() {
             }
             
             if (tokens[current_token].type != RPAREN) {
-                printf("Error: Expected ')'");
-                exit(1);
+                fatal_error("Error: Expected ')'");
+            }
+            current_token++;
+        } else if (tokens[current_token].type == LBRACKET) {
+            // 数组下标表达式
+            node->type = NODE_INDEX_EXPR;
+            current_token++;
+            node->left = parse_expression();
+            if (tokens[current_token].type != RBRACKET) {
+                fatal_error("Error: Expected ']'");
             }
             current_token++;
         }
@@ -295,26 +841,22 @@ Node *parse_factor() {
         current_token++;
         node = parse_expression();
         if (tokens[current_token].type != RPAREN) {
-            printf("Error: Expected ')'");
-            exit(1);
+            fatal_error("Error: Expected ')'");
         }
         current_token++;
     } else if (tokens[current_token].type == INPUT) {
         node = create_node(NODE_INPUT_EXPR);
         current_token++;
         if (tokens[current_token].type != LPAREN) {
-            printf("Error: Expected '('");
-            exit(1);
+            fatal_error("Error: Expected '('");
         }
         current_token++;
         if (tokens[current_token].type != RPAREN) {
-            printf("Error: Expected ')'");
-            exit(1);
+            fatal_error("Error: Expected ')'");
         }
         current_token++;
     } else {
-        printf("Error: Unexpected token");
-        exit(1);
+        fatal_error("Error: Unexpected token");
     }
     
     return node;
@@ -328,7 +870,7 @@ Node *parse_term() {
            (strcmp(tokens[current_token].value, "*") == 0 || 
             strcmp(tokens[current_token].value, "/") == 0)) {
         Node *op_node = create_node(NODE_BINARY_OP);
-        strcpy(op_node->name, tokens[current_token].value);
+        op_node->name = tokens[current_token].value;
         op_node->left = node;
         current_token++;
         op_node->right = parse_factor();
@@ -352,7 +894,7 @@ Node *parse_expression() {
             strcmp(tokens[current_token].value, "<=") == 0 || 
             strcmp(tokens[current_token].value, ">=") == 0)) {
         Node *op_node = create_node(NODE_BINARY_OP);
-        strcpy(op_node->name, tokens[current_token].value);
+        op_node->name = tokens[current_token].value;
         op_node->left = node;
         current_token++;
         op_node->right = parse_term();
@@ -362,6 +904,60 @@ Node *parse_expression() {
     return node;
 }
 
+Node *parse_statement_list();
+
+// 解析函数体和返回语句，直到匹配的 '}'
+void parse_function_body(Node *def) {
+    def->body = parse_statement_list();
+    
+    // 解析返回语句
+    if (tokens[current_token].type == RETURN) {
+        current_token++;
+        def->return_expr = parse_expression();
+        
+        if (tokens[current_token].type != SEMICOLON) {
+            fatal_error("Error: Expected ';'");
+        }
+        current_token++;
+    }
+    
+    if (tokens[current_token].type != RBRACE) {
+        fatal_error("Error: Expected '}'");
+    }
+    current_token++;
+}
+
+// 预解析：只做花括号匹配，记录函数体的标记范围，首次调用时再解析
+// 函数体内含嵌套 def 时返回 0，由调用方照常解析，保证嵌套函数在解析时登记
+int skip_function_body(Node *def) {
+    int depth = 1;
+    int i = current_token;
+    while (depth > 0) {
+        switch (tokens[i].type) {
+            case END:
+                fatal_error("Error: Expected '}'");
+            case DEF:
+                return 0;
+            case LBRACE:
+                depth++;
+                break;
+            case RBRACE:
+                depth--;
+                break;
+            default:
+                break;
+        }
+        i++;
+    }
+    
+    // 标记数组被延迟函数引用后，下次 tokenize 改用新数组
+    def->lazy_tokens = &tokens[current_token];
+    def->value = i - current_token;
+    tokens_pinned = 1;
+    current_token = i;
+    return 1;
+}
+
 // 解析语句列表
 Node *parse_statement_list() {
     Node *head = NULL;
@@ -371,34 +967,63 @@ Node *parse_statement_list() {
            tokens[current_token].type != RBRACE && 
            tokens[current_token].type != RETURN) {
         Node *stmt = NULL;
+        int line = tokens[current_token].line;
         
         if (tokens[current_token].type == INT) {
             // 变量声明
             current_token++;
             stmt = create_node(NODE_VAR_DECL);
-            strcpy(stmt->name, tokens[current_token].value);
+            stmt->name = tokens[current_token].value;
             current_token++;
             
-            if (tokens[current_token].type == OP && strcmp(tokens[current_token].value, "=") == 0) {
+            // 数组声明：int name[N];
+            if (tokens[current_token].type == LBRACKET) {
+                stmt->type = NODE_ARRAY_DECL;
+                current_token++;
+                stmt->left = parse_expression();
+                if (tokens[current_token].type != RBRACKET) {
+                    fatal_error("Error: Expected ']'");
+                }
+                current_token++;
+            } else if (tokens[current_token].type == OP && strcmp(tokens[current_token].value, "=") == 0) {
                 current_token++;
                 stmt->right = parse_expression();
             }
             
             if (tokens[current_token].type != SEMICOLON) {
-                printf("Error: Expected ';' at token %d, type %d, value %s\n", current_token, tokens[current_token].type, tokens[current_token].value);
-                exit(1);
+                fatal_error("Error: Expected ';' at token %d, type %d, value %s\n", current_token, tokens[current_token].type, tokens[current_token].value);
+            }
+            current_token++;
+        } else if (tokens[current_token].type == ID && tokens[current_token+1].type == LBRACKET) {
+            // 数组元素赋值
+            stmt = create_node(NODE_INDEX_ASSIGN);
+            stmt->name = tokens[current_token].value;
+            current_token += 2;
+            stmt->left = parse_expression();
+            
+            if (tokens[current_token].type != RBRACKET) {
+                fatal_error("Error: Expected ']'");
+            }
+            current_token++;
+            if (tokens[current_token].type != OP || strcmp(tokens[current_token].value, "=") != 0) {
+                fatal_error("Error: Expected '='");
+            }
+            current_token++;
+            stmt->right = parse_expression();
+            
+            if (tokens[current_token].type != SEMICOLON) {
+                fatal_error("Error: Expected ';'");
             }
             current_token++;
         } else if (tokens[current_token].type == ID && tokens[current_token+1].type == OP && strcmp(tokens[current_token+1].value, "=") == 0) {
             // 赋值语句
             stmt = create_node(NODE_ASSIGNMENT);
-            strcpy(stmt->name, tokens[current_token].value);
+            stmt->name = tokens[current_token].value;
             current_token += 2;
             stmt->right = parse_expression();
             
             if (tokens[current_token].type != SEMICOLON) {
-                printf("Error: Expected ';'");
-                exit(1);
+                fatal_error("Error: Expected ';'");
             }
             current_token++;
         } else if (tokens[current_token].type == IF) {
@@ -407,68 +1032,61 @@ Node *parse_statement_list() {
             stmt = create_node(NODE_IF_STMT);
             
             if (tokens[current_token].type != LPAREN) {
-                printf("Error: Expected '('");
-                exit(1);
+                fatal_error("Error: Expected '('");
             }
             current_token++;
             stmt->left = parse_expression();
             
             if (tokens[current_token].type != RPAREN) {
-                printf("Error: Expected ')'");
-                exit(1);
+                fatal_error("Error: Expected ')'");
             }
             current_token++;
             
             if (tokens[current_token].type != LBRACE) {
-                printf("Error: Expected '{'");
-                exit(1);
+                fatal_error("Error: Expected '{'");
             }
             current_token++;
             stmt->body = parse_statement_list();
             
             if (tokens[current_token].type != RBRACE) {
-                printf("Error: Expected '}'");
-                exit(1);
+                fatal_error("Error: Expected '}'");
             }
             current_token++;
             
             if (tokens[current_token].type == ELSE) {
                 current_token++;
                 if (tokens[current_token].type != LBRACE) {
-                    printf("Error: Expected '{'");
-                    exit(1);
+                    fatal_error("Error: Expected '{'");
                 }
                 current_token++;
                 stmt->else_body = parse_statement_list();
                 
                 if (tokens[current_token].type != RBRACE) {
-                    printf("Error: Expected '}'");
-                    exit(1);
+                    fatal_error("Error: Expected '}'");
                 }
                 current_token++;
             }
-        } else if (tokens[current_token].type == FOR) {
-            // for语句
+        } else if (tokens[current_token].type == FOR || tokens[current_token].type == PARFOR) {
+            // for / parfor 语句
+            stmt = create_node(tokens[current_token].type == FOR ? NODE_FOR_STMT : NODE_PARFOR_STMT);
             current_token++;
-            stmt = create_node(NODE_FOR_STMT);
             
             if (tokens[current_token].type != LPAREN) {
-                printf("Error: Expected '('");
-                exit(1);
+                fatal_error("Error: Expected '('");
             }
             current_token++;
             
-            // 初始化语句
+            // 初始化语句；带类型的记为声明，执行上与赋值相同
             if (tokens[current_token].type == INT) {
                 // 跳过类型声明
                 current_token++;
-                stmt->left = create_node(NODE_ASSIGNMENT);
-                strcpy(stmt->left->name, tokens[current_token].value);
+                stmt->left = create_node(NODE_VAR_DECL);
+                stmt->left->name = tokens[current_token].value;
                 current_token += 2;
                 stmt->left->right = parse_expression();
             } else if (tokens[current_token].type == ID && tokens[current_token+1].type == OP && strcmp(tokens[current_token+1].value, "=") == 0) {
                 stmt->left = create_node(NODE_ASSIGNMENT);
-                strcpy(stmt->left->name, tokens[current_token].value);
+                stmt->left->name = tokens[current_token].value;
                 current_token += 2;
                 stmt->left->right = parse_expression();
             }
@@ -486,40 +1104,64 @@ Node *parse_statement_list() {
                 current_token++;
                 if (tokens[current_token].type == ID && tokens[current_token+1].type == OP && strcmp(tokens[current_token+1].value, "=") == 0) {
                     stmt->body = create_node(NODE_ASSIGNMENT);
-                    strcpy(stmt->body->name, tokens[current_token].value);
+                    stmt->body->name = tokens[current_token].value;
                     current_token += 2;
                     stmt->body->right = parse_expression();
                 }
             }
             
             if (tokens[current_token].type != RPAREN) {
-                printf("Error: Expected ')'");
-                exit(1);
+                fatal_error("Error: Expected ')'");
             }
             current_token++;
             
+            // parfor 的归约子句：sum(x) / min(x) / max(x)，name 记录归约变量，value 记录归约类型
+            if (stmt->type == NODE_PARFOR_STMT && tokens[current_token].type == ID) {
+                const char *kind = tokens[current_token].value;
+                if (strcmp(kind, "sum") == 0) {
+                    stmt->value = REDUCE_SUM;
+                } else if (strcmp(kind, "min") == 0) {
+                    stmt->value = REDUCE_MIN;
+                } else if (strcmp(kind, "max") == 0) {
+                    stmt->value = REDUCE_MAX;
+                } else {
+                    fatal_error("Error: Unknown parfor reduction: %s", kind);
+                }
+                current_token++;
+                if (tokens[current_token].type != LPAREN) {
+                    fatal_error("Error: Expected '('");
+                }
+                current_token++;
+                if (tokens[current_token].type != ID) {
+                    fatal_error("Error: Expected reduction variable");
+                }
+                stmt->name = tokens[current_token].value;
+                current_token++;
+                if (tokens[current_token].type != RPAREN) {
+                    fatal_error("Error: Expected ')'");
+                }
+                current_token++;
+            }
+            
             if (tokens[current_token].type != LBRACE) {
-                printf("Error: Expected '{'");
-                exit(1);
+                fatal_error("Error: Expected '{'");
             }
             current_token++;
             stmt->else_body = parse_statement_list();
             
             if (tokens[current_token].type != RBRACE) {
-                printf("Error: Expected '}'");
-                exit(1);
+                fatal_error("Error: Expected '}'");
             }
             current_token++;
         } else if (tokens[current_token].type == DEF) {
             // 函数定义
             current_token++;
             stmt = create_node(NODE_FUNCTION_DEF);
-            strcpy(stmt->name, tokens[current_token].value);
+            stmt->name = tokens[current_token].value;
             current_token++;
             
             if (tokens[current_token].type != LPAREN) {
-                printf("Error: Expected '('");
-                exit(1);
+                fatal_error("Error: Expected '('");
             }
             current_token++;
             
@@ -530,7 +1172,7 @@ Node *parse_statement_list() {
                     current_token++;
                 }
                 stmt->params = create_node(NODE_IDENTIFIER);
-                strcpy(stmt->params->name, tokens[current_token].value);
+                stmt->params->name = tokens[current_token].value;
                 current_token++;
                 
                 while (tokens[current_token].type == COMMA) {
@@ -540,7 +1182,7 @@ Node *parse_statement_list() {
                         current_token++;
                     }
                     Node *param = create_node(NODE_IDENTIFIER);
-                    strcpy(param->name, tokens[current_token].value);
+                    param->name = tokens[current_token].value;
                     param->next = stmt->params;
                     stmt->params = param;
                     current_token++;
@@ -548,76 +1190,52 @@ Node *parse_statement_list() {
             }
             
             if (tokens[current_token].type != RPAREN) {
-                printf("Error: Expected ')'");
-                exit(1);
+                fatal_error("Error: Expected ')'");
             }
             current_token++;
             
             if (tokens[current_token].type != LBRACE) {
-                printf("Error: Expected '{'");
-                exit(1);
+                fatal_error("Error: Expected '{'");
             }
             current_token++;
             
-            // 解析函数体
-            stmt->body = parse_statement_list();
-            
-            // 解析返回语句
-            if (tokens[current_token].type == RETURN) {
-                current_token++;
-                stmt->return_expr = parse_expression();
-                
-                if (tokens[current_token].type != SEMICOLON) {
-                    printf("Error: Expected ';'");
-                    exit(1);
-                }
-                current_token++;
+            // 解析函数体；预解析模式下只记录函数体的标记范围
+            if (!lazy_parse || !skip_function_body(stmt)) {
+                parse_function_body(stmt);
             }
             
-            if (tokens[current_token].type != RBRACE) {
-                printf("Error: Expected '}'");
-                exit(1);
+            // 添加函数到函数列表；并行前端由合并阶段按源码顺序登记
+            if (register_defs) {
+                add_function(stmt);
             }
-            current_token++;
-            
-            // 添加函数到函数列表
-            strcpy(functions[function_count].name, stmt->name);
-            functions[function_count].params = stmt->params;
-            functions[function_count].body = stmt->body;
-            functions[function_count].return_expr = stmt->return_expr;
-            function_count++;
         } else if (tokens[current_token].type == PRINT) {
             // print语句
             current_token++;
             stmt = create_node(NODE_PRINT_STMT);
             
             if (tokens[current_token].type != LPAREN) {
-                printf("Error: Expected '('");
-                exit(1);
+                fatal_error("Error: Expected '('");
             }
             current_token++;
             stmt->left = parse_expression();
             
             if (tokens[current_token].type != RPAREN) {
-                printf("Error: Expected ')'");
-                exit(1);
+                fatal_error("Error: Expected ')'");
             }
             current_token++;
             
             if (tokens[current_token].type != SEMICOLON) {
-                printf("Error: Expected ';'");
-                exit(1);
+                fatal_error("Error: Expected ';'");
             }
             current_token++;
         } else if (tokens[current_token].type == ID && tokens[current_token+1].type == LPAREN) {
             // 函数调用
             stmt = create_node(NODE_FUNCTION_CALL);
-            strcpy(stmt->name, tokens[current_token].value);
+            stmt->name = tokens[current_token].value;
             current_token++;
             
             if (tokens[current_token].type != LPAREN) {
-                printf("Error: Expected '('");
-                exit(1);
+                fatal_error("Error: Expected '('");
             }
             current_token++;
             
@@ -625,27 +1243,25 @@ Node *parse_statement_list() {
                 stmt->args = parse_expression();
                 while (tokens[current_token].type == COMMA) {
                     current_token++;
-                    Node *arg = create_node(NODE_IDENTIFIER);
+                    Node *arg = parse_expression();
                     arg->next = stmt->args;
-                    stmt->args = parse_expression();
+                    stmt->args = arg;
                 }
             }
             
             if (tokens[current_token].type != RPAREN) {
-                printf("Error: Expected ')'");
-                exit(1);
+                fatal_error("Error: Expected ')'");
             }
             current_token++;
             
             if (tokens[current_token].type != SEMICOLON) {
-                printf("Error: Expected ';'");
-                exit(1);
+                fatal_error("Error: Expected ';'");
             }
             current_token++;
         } else {
-            printf("Error: Unexpected token");
-            exit(1);
+            fatal_error("Error: Unexpected token");
         }
+        stmt->line = line;
         
         if (head == NULL) {
             head = stmt;
@@ -663,268 +1279,3291 @@ Node *parse_statement_list() {
 Node *parse_program() {
     Node *program = create_node(NODE_PROGRAM);
     program->body = parse_statement_list();
+    report_node_count();
     return program;
 }
 
-// 在作用域中查找变量
-int find_variable(Scope *scope, const char *name) {
-    for (int i = 0; i < scope->count; i++) {
-        if (strcmp(scope->variables[i], name) == 0) {
-            return scope->values[i];
+// 跳过空白和注释
+const char *skip_blank(const char *p, const char *end) {
+    while (p < end) {
+        if (isspace((unsigned char)*p)) {
+            p++;
+        } else if (*p == '/' && p + 1 < end && p[1] == '/') {
+            while (p < end && *p != '\n') {
+                p++;
+            }
+        } else {
+            break;
         }
     }
+    return p;
+}
+
+// 预扫描时需要检查的字符
+const unsigned char scan_chars[256] = {
+    ['/'] = 1, ['('] = 1, [')'] = 1, ['{'] = 1, ['}'] = 1, [';'] = 1
+};
+
+// 预扫描：按花括号、圆括号深度和 ';' 把源码切成顶层单元，不做词法分析
+// 顶层的 '}' 之后紧跟 else 时属于同一条 if 语句
+int scan_top_level(const char *code, long size, Unit **units) {
+    const char *end = code + size;
+    const char *p = skip_blank(code, end);
+    const char *counted = code;
+    int line = 1;
+    int count = 0;
+    int capacity = 0;
+    *units = NULL;
     
-    if (scope->parent) {
-        return find_variable(scope->parent, name);
+    while (p < end) {
+        const char *start = p;
+        int braces = 0;
+        int parens = 0;
+        
+        while (p < end) {
+            // 快速跳过不影响切分的字符
+            while (p < end && !scan_chars[(unsigned char)*p]) {
+                p++;
+            }
+            if (p >= end) {
+                break;
+            }
+            char c = *p;
+            if (c == '/' && p + 1 < end && p[1] == '/') {
+                const char *newline = memchr(p, '\n', end - p);
+                p = newline ? newline : end;
+                continue;
+            }
+            p++;
+            if (c == '(') {
+                parens++;
+            } else if (c == ')') {
+                parens--;
+            } else if (c == '{') {
+                braces++;
+            } else if (c == '}') {
+                braces--;
+                if (braces == 0 && parens == 0) {
+                    const char *next = skip_blank(p, end);
+                    if (next + 4 <= end && memcmp(next, "else", 4) == 0 &&
+                        (next + 4 == end || !(isalnum((unsigned char)next[4]) || next[4] == '_'))) {
+                        continue;
+                    }
+                    break;
+                }
+            } else if (c == ';' && braces == 0 && parens == 0) {
+                break;
+            }
+        }
+        
+        if (count >= capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            *units = (Unit *)realloc(*units, sizeof(Unit) * capacity);
+            if (*units == NULL) {
+                fatal_error("Error: Out of memory");
+            }
+        }
+        // 单元起始行号：统计上一个单元起点到这里的换行数
+        for (const char *nl = counted; (nl = memchr(nl, '\n', start - nl)) != NULL; nl++) {
+            line++;
+        }
+        counted = start;
+        
+        Unit *unit = &(*units)[count++];
+        unit->text = start;
+        unit->length = (int)(p - start);
+        unit->line = line;
+        unit->hash = hash_bytes(start, unit->length);
+        unit->ast = NULL;
+        unit->defs = NULL;
+        unit->def_count = 0;
+        p = skip_blank(p, end);
     }
     
-    printf("Error: Variable not defined: %s", name);
-    exit(1);
+    return count;
 }
 
-// 在作用域中设置变量
-void set_variable(Scope *scope, const char *name, int value) {
-    for (int i = 0; i < scope->count; i++) {
-        if (strcmp(scope->variables[i], name) == 0) {
-            scope->values[i] = value;
-            return;
+// 收集语句链中（含嵌套块）的函数定义，顺序与串行解析时登记的顺序相同（嵌套的 def 在外层 def 之前）
+void collect_defs(Node *node, Node ***defs, int *count, int *capacity) {
+    for (; node != NULL; node = node->next) {
+        if (node->type == NODE_FUNCTION_DEF) {
+            // 串行解析先登记函数体内的 def，再登记外层 def，这里保持同样的顺序
+            collect_defs(node->body, defs, count, capacity);
+            if (*count >= *capacity) {
+                *capacity = *capacity ? *capacity * 2 : 4;
+                *defs = (Node **)realloc(*defs, sizeof(Node *) * *capacity);
+                if (*defs == NULL) {
+                    fatal_error("Error: Out of memory");
+                }
+            }
+            (*defs)[(*count)++] = node;
+        } else if (node->type == NODE_IF_STMT) {
+            collect_defs(node->body, defs, count, capacity);
+            collect_defs(node->else_body, defs, count, capacity);
+        } else if (node->type == NODE_FOR_STMT || node->type == NODE_PARFOR_STMT) {
+            collect_defs(node->else_body, defs, count, capacity);
         }
     }
+}
+
+// 对单个顶层单元做词法、语法分析
+void parse_unit(Unit *unit) {
+    tokenize_text(unit->text, unit->length, unit->line);
     
-    if (scope->count < 100) {
-        strcpy(scope->variables[scope->count], name);
-        scope->values[scope->count] = value;
-        scope->count++;
+    unit->ast = parse_statement_list();
+    report_node_count();
+    if (tokens[current_token].type != END) {
+        fatal_error("Error: Unexpected token");
     }
+    
+    int capacity = 0;
+    unit->defs = NULL;
+    unit->def_count = 0;
+    collect_defs(unit->ast, &unit->defs, &unit->def_count, &capacity);
 }
 
-// 查找函数
-Function *find_function(const char *name) {
-    for (int i = 0; i < function_count; i++) {
-        if (strcmp(functions[i].name, name) == 0) {
-            return &functions[i];
+// 可用 CPU 核数
+int cpu_count() {
+#ifdef _WIN32
+    return 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+// 线程池：固定数量的工作线程，主线程作为 0 号参与者同时执行任务
+// 任务下标区间预先均分给各参与者，参与者从自己区间的前端领取任务，
+// 区间为空时从其他参与者区间的后端窃取一半
+typedef void (*TaskFunc)(void *context, int index);
+
+// 每个参与者的任务区间，按缓存行对齐避免伪共享
+typedef struct {
+    pthread_mutex_t lock;
+    int begin;
+    int end;
+} __attribute__((aligned(64))) TaskRange;
+
+#define POOL_MAX_THREADS 256
+
+pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+TaskRange pool_ranges[POOL_MAX_THREADS] = {{PTHREAD_MUTEX_INITIALIZER, 0, 0}};
+int pool_workers = 0;
+int pool_generation = 0;
+int pool_active = 0;
+int pool_participants = 0;
+TaskFunc pool_func = NULL;
+void *pool_context = NULL;
+THREAD_LOCAL int in_pool_task = 0;
+
+// 从参与者 self 的区间领取一个任务；为空时窃取，全部为空返回 -1
+int pool_take(int self) {
+    TaskRange *own = &pool_ranges[self];
+    pthread_mutex_lock(&own->lock);
+    if (own->begin < own->end) {
+        int index = own->begin++;
+        pthread_mutex_unlock(&own->lock);
+        return index;
+    }
+    pthread_mutex_unlock(&own->lock);
+    
+    for (int k = 1; k < pool_participants; k++) {
+        TaskRange *victim = &pool_ranges[(self + k) % pool_participants];
+        pthread_mutex_lock(&victim->lock);
+        int remaining = victim->end - victim->begin;
+        if (remaining > 0) {
+            int mid = victim->end - (remaining + 1) / 2;
+            int stolen_end = victim->end;
+            victim->end = mid;
+            pthread_mutex_unlock(&victim->lock);
+            
+            // 窃取的后半段第一个任务直接执行，其余放入自己的区间
+            pthread_mutex_lock(&own->lock);
+            own->begin = mid + 1;
+            own->end = stolen_end;
+            pthread_mutex_unlock(&own->lock);
+            return mid;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+    return -1;
+}
+
+// 领取并执行任务，直到所有区间都为空
+void pool_work(int self) {
+    int index;
+    in_pool_task = 1;
+    while ((index = pool_take(self)) >= 0) {
+        pool_func(pool_context, index);
+    }
+    in_pool_task = 0;
+}
+
+void *pool_worker(void *arg) {
+    int self = (int)(long)arg;
+    int seen = 0;
+    set_stack_limit(0);
+    pthread_mutex_lock(&pool_mutex);
+    while (1) {
+        while (pool_generation == seen) {
+            pthread_cond_wait(&pool_wake, &pool_mutex);
+        }
+        seen = pool_generation;
+        int participate = self < pool_participants;
+        pthread_mutex_unlock(&pool_mutex);
+        
+        if (participate) {
+            pool_work(self);
+        }
+        
+        pthread_mutex_lock(&pool_mutex);
+        if (--pool_active == 0) {
+            pthread_cond_signal(&pool_done);
+        }
+    }
+    return NULL;
+}
+
+// 确保线程池共有 threads 个线程（含主线程）
+void pool_start(int threads) {
+    if (threads > POOL_MAX_THREADS) {
+        threads = POOL_MAX_THREADS;
+    }
+    while (pool_workers < threads - 1) {
+        pthread_t thread;
+        pthread_mutex_init(&pool_ranges[pool_workers + 1].lock, NULL);
+        if (pthread_create(&thread, NULL, pool_worker, (void *)(long)(pool_workers + 1)) != 0) {
+            break;
+        }
+        pthread_detach(thread);
+        pool_workers++;
+    }
+}
+
+// 用至多 threads 个线程（含主线程）并行执行 task_count 个任务，全部完成后返回
+// 在任务内部再次调用时直接串行执行
+void pool_run(int task_count, int threads, TaskFunc func, void *context) {
+    int participants = threads < pool_workers + 1 ? threads : pool_workers + 1;
+    if (participants <= 1 || task_count <= 1 || in_pool_task) {
+        for (int i = 0; i < task_count; i++) {
+            func(context, i);
+        }
+        return;
+    }
+    
+    pthread_mutex_lock(&pool_mutex);
+    pool_func = func;
+    pool_context = context;
+    pool_participants = participants;
+    for (int p = 0; p < participants; p++) {
+        pool_ranges[p].begin = (int)((long)task_count * p / participants);
+        pool_ranges[p].end = (int)((long)task_count * (p + 1) / participants);
+    }
+    pool_active = pool_workers;
+    pool_generation++;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_mutex);
+    
+    pool_work(0);
+    
+    pthread_mutex_lock(&pool_mutex);
+    while (pool_active > 0) {
+        pthread_cond_wait(&pool_done, &pool_mutex);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+// 并行前端的一个分块：若干相邻的顶层单元
+typedef struct {
+    Unit unit;
+    int failed;
+    char error[ERROR_MESSAGE_SIZE];
+    FrontendStats stats;
+} ParseChunk;
+
+#define PARSE_CHUNK_MIN_SIZE (64 * 1024)
+
+// 在当前线程中分析一个分块，错误信息记录在分块里
+void parse_chunk_task(void *context, int index) {
+    ParseChunk *chunk = &((ParseChunk *)context)[index];
+    jmp_buf *saved_jmp = error_jmp;
+    char *saved_message = error_message;
+    long nodes = node_count;
+    size_t lexeme_bytes = lexeme_arena.total;
+    size_t node_bytes = node_arena.total;
+    jmp_buf env;
+    
+    error_jmp = &env;
+    error_message = chunk->error;
+    register_defs = 0;
+    if (setjmp(env) == 0) {
+        parse_unit(&chunk->unit);
+        chunk->stats.tokens = token_count;
+        chunk->stats.token_bytes = sizeof(Token) * (size_t)token_count;
+    } else {
+        chunk->failed = 1;
+    }
+    register_defs = 1;
+    error_jmp = saved_jmp;
+    error_message = saved_message;
+    
+    chunk->stats.nodes = node_count - nodes;
+    chunk->stats.lexeme_bytes = lexeme_arena.total - lexeme_bytes;
+    chunk->stats.node_bytes = node_arena.total - node_bytes;
+}
+
+// 并行前端：预扫描切分顶层单元，分块后在线程池中并发做词法、语法分析，
+// 再按源码顺序拼接语句链并登记函数，函数表与串行分析的结果一致
+Node *parse_program_parallel(const char *code, long size, FrontendStats *stats) {
+    Unit *units = NULL;
+    int count = scan_top_level(code, size, &units);
+    
+    pool_start(frontend_jobs);
+    long target = size / ((long)frontend_jobs * 8);
+    if (target < PARSE_CHUNK_MIN_SIZE) {
+        target = PARSE_CHUNK_MIN_SIZE;
+    }
+    
+    // 相邻单元合并成大小接近 target 的分块
+    ParseChunk *chunks = (ParseChunk *)calloc(count > 0 ? count : 1, sizeof(ParseChunk));
+    if (chunks == NULL) {
+        fatal_error("Error: Out of memory");
+    }
+    int chunk_count = 0;
+    for (int i = 0; i < count; i++) {
+        Unit *unit = &chunks[chunk_count].unit;
+        if (unit->text == NULL) {
+            unit->text = units[i].text;
+            unit->line = units[i].line;
+        }
+        unit->length = (int)(units[i].text + units[i].length - unit->text);
+        if (unit->length >= target || i == count - 1) {
+            chunk_count++;
+        }
+    }
+    free(units);
+    
+    pool_run(chunk_count, frontend_jobs, parse_chunk_task, chunks);
+    
+    // 按源码顺序报告第一个错误
+    for (int i = 0; i < chunk_count; i++) {
+        if (chunks[i].failed) {
+            char message[ERROR_MESSAGE_SIZE];
+            memcpy(message, chunks[i].error, sizeof(message));
+            free(chunks);
+            fatal_error("%s", message);
+        }
+    }
+    
+    // 合并
+    Node *program = create_node(NODE_PROGRAM);
+    Node *tail = NULL;
+    for (int i = 0; i < chunk_count; i++) {
+        ParseChunk *chunk = &chunks[i];
+        if (chunk->unit.ast != NULL) {
+            if (tail == NULL) {
+                program->body = chunk->unit.ast;
+            } else {
+                tail->next = chunk->unit.ast;
+            }
+            for (tail = chunk->unit.ast; tail->next != NULL; tail = tail->next) {
+            }
+        }
+        for (int j = 0; j < chunk->unit.def_count; j++) {
+            add_function(chunk->unit.defs[j]);
+        }
+        free(chunk->unit.defs);
+        
+        if (stats != NULL) {
+            stats->tokens += chunk->stats.tokens;
+            stats->nodes += chunk->stats.nodes;
+            stats->token_bytes += chunk->stats.token_bytes;
+            stats->lexeme_bytes += chunk->stats.lexeme_bytes;
+            stats->node_bytes += chunk->stats.node_bytes;
+        }
+    }
+    free(chunks);
+    return program;
+}
+
+// 在作用域中查找变量
+int find_variable(Scope *scope, const char *name) {
+    for (int i = 0; i < scope->count; i++) {
+        if (strcmp(scope->variables[i], name) == 0) {
+            if (scope->arrays[i] != NULL) {
+                fatal_error("Error: %s is an array", name);
+            }
+            return scope->values[i];
+        }
+    }
+    
+    if (scope->parent) {
+        return find_variable(scope->parent, name);
+    }
+    
+    fatal_error("Error: Variable not defined: %s", name);
+}
+
+// 在作用域中设置变量
+void set_variable(Scope *scope, const char *name, int value) {
+    for (int i = 0; i < scope->count; i++) {
+        if (strcmp(scope->variables[i], name) == 0) {
+            if (scope->arrays[i] != NULL) {
+                fatal_error("Error: %s is an array", name);
+            }
+            scope->values[i] = value;
+            return;
+        }
+    }
+    
+    if (scope->count < 100) {
+        scope->variables[scope->count] = name;
+        scope->values[scope->count] = value;
+        scope->count++;
+    }
+}
+
+// 分配数组：缓冲区按 64 字节对齐、长度补齐到 64 字节，内容清零
+Array *array_alloc(int length) {
+    size_t bytes = ((size_t)length * sizeof(int) + 63) & ~(size_t)63;
+    Array *array = (Array *)malloc(sizeof(Array));
+    void *data = NULL;
+    if (array == NULL) {
+        fatal_error("Error: Out of memory");
+    }
+#ifdef _WIN32
+    data = _aligned_malloc(bytes > 0 ? bytes : 64, 64);
+#else
+    if (posix_memalign(&data, 64, bytes > 0 ? bytes : 64) != 0) {
+        data = NULL;
+    }
+#endif
+    if (data == NULL) {
+        free(array);
+        fatal_error("Error: Out of memory");
+    }
+    memset(data, 0, bytes);
+    array->data = (int *)data;
+    array->length = length;
+    long long size = (long long)(bytes + sizeof(Array));
+    update_peak(&memory_stats.peak_array_bytes, STAT_ADD(array_bytes, size) + size);
+    return array;
+}
+
+void array_free(Array *array) {
+    if (array == NULL) {
+        return;
+    }
+    STAT_ADD(array_bytes, -(long long)((((size_t)array->length * sizeof(int) + 63) & ~(size_t)63) + sizeof(Array)));
+#ifdef _WIN32
+    _aligned_free(array->data);
+#else
+    free(array->data);
+#endif
+    free(array);
+}
+
+// 在当前作用域声明数组；同名数组重新声明时释放旧的缓冲区
+void declare_array(Scope *scope, const char *name, int length) {
+    if (length < 0) {
+        fatal_error("Error: Invalid array size for %s: %d", name, length);
+    }
+    for (int i = 0; i < scope->count; i++) {
+        if (strcmp(scope->variables[i], name) == 0) {
+            Array *array = array_alloc(length);
+            array_free(scope->arrays[i]);
+            scope->arrays[i] = array;
+            scope->values[i] = 0;
+            return;
+        }
+    }
+    
+    if (scope->count >= 100) {
+        fatal_error("Error: Too many variables");
+    }
+    scope->variables[scope->count] = name;
+    scope->values[scope->count] = 0;
+    scope->arrays[scope->count] = array_alloc(length);
+    scope->count++;
+}
+
+// 查找数组：沿作用域链找到第一个同名变量，它必须是数组
+Array *find_array(Scope *scope, const char *name) {
+    for (; scope != NULL; scope = scope->parent) {
+        for (int i = 0; i < scope->count; i++) {
+            if (strcmp(scope->variables[i], name) == 0) {
+                if (scope->arrays[i] == NULL) {
+                    fatal_error("Error: %s is not an array", name);
+                }
+                return scope->arrays[i];
+            }
+        }
+    }
+    
+    fatal_error("Error: Array not defined: %s", name);
+}
+
+// 带边界检查的下标
+int *array_element(Scope *scope, const char *name, int index) {
+    Array *array = find_array(scope, name);
+    if (index < 0 || index >= array->length) {
+        fatal_error("Error: Index %d out of range for %s[%d]", index, name, array->length);
+    }
+    return &array->data[index];
+}
+
+// 作用域结束时释放其中声明的数组
+void release_arrays(Scope *scope) {
+    for (int i = 0; i < scope->count; i++) {
+        if (scope->arrays[i] != NULL) {
+            array_free(scope->arrays[i]);
+            scope->arrays[i] = NULL;
+        }
+    }
+}
+
+// 用户函数返回：释放局部数组并弹出栈帧
+void leave_frame(Frame *frame) {
+    release_arrays(frame->scope);
+    frame_top = frame->next;
+    call_depth--;
+}
+
+// 出错时释放 mark 之上各栈帧中的数组；在跳转前调用，此时这些栈帧仍然有效
+void unwind_frames(Frame *mark) {
+    while (frame_top != NULL && frame_top != mark) {
+        release_arrays(frame_top->scope);
+        frame_top = frame_top->next;
+    }
+}
+
+// 数组内核：标量版本用无符号运算实现回绕，AVX2 版本每次处理 8 个元素
+// 数组起始地址按 64 字节对齐，按 8 个元素步进时可以使用对齐加载
+void fill_scalar(int *dst, int length, int value) {
+    for (int i = 0; i < length; i++) {
+        dst[i] = value;
+    }
+}
+
+int sum_scalar(const int *a, int length) {
+    unsigned int total = 0;
+    for (int i = 0; i < length; i++) {
+        total += (unsigned int)a[i];
+    }
+    return (int)total;
+}
+
+int dot_scalar(const int *a, const int *b, int length) {
+    unsigned int total = 0;
+    for (int i = 0; i < length; i++) {
+        total += (unsigned int)a[i] * (unsigned int)b[i];
+    }
+    return (int)total;
+}
+
+void add_scalar(int *dst, const int *a, const int *b, int length) {
+    for (int i = 0; i < length; i++) {
+        dst[i] = (int)((unsigned int)a[i] + (unsigned int)b[i]);
+    }
+}
+
+void mul_scalar(int *dst, const int *a, const int *b, int length) {
+    for (int i = 0; i < length; i++) {
+        dst[i] = (int)((unsigned int)a[i] * (unsigned int)b[i]);
+    }
+}
+
+int min_scalar(const int *a, int length) {
+    int result = a[0];
+    for (int i = 1; i < length; i++) {
+        result = a[i] < result ? a[i] : result;
+    }
+    return result;
+}
+
+int max_scalar(const int *a, int length) {
+    int result = a[0];
+    for (int i = 1; i < length; i++) {
+        result = a[i] > result ? a[i] : result;
+    }
+    return result;
+}
+
+#ifdef HAVE_AVX2_KERNELS
+__attribute__((target("avx2"))) int horizontal_sum_avx2(__m256i v) {
+    __m128i x = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    x = _mm_add_epi32(x, _mm_shuffle_epi32(x, 0x4e));
+    x = _mm_add_epi32(x, _mm_shuffle_epi32(x, 0xb1));
+    return _mm_cvtsi128_si32(x);
+}
+
+__attribute__((target("avx2"))) void fill_avx2(int *dst, int length, int value) {
+    __m256i v = _mm256_set1_epi32(value);
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        _mm256_store_si256((__m256i *)(dst + i), v);
+    }
+    fill_scalar(dst + i, length - i, value);
+}
+
+__attribute__((target("avx2"))) int sum_avx2(const int *a, int length) {
+    __m256i s0 = _mm256_setzero_si256();
+    __m256i s1 = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 16 <= length; i += 16) {
+        s0 = _mm256_add_epi32(s0, _mm256_load_si256((const __m256i *)(a + i)));
+        s1 = _mm256_add_epi32(s1, _mm256_load_si256((const __m256i *)(a + i + 8)));
+    }
+    unsigned int total = (unsigned int)horizontal_sum_avx2(_mm256_add_epi32(s0, s1));
+    return (int)(total + (unsigned int)sum_scalar(a + i, length - i));
+}
+
+__attribute__((target("avx2"))) int dot_avx2(const int *a, const int *b, int length) {
+    __m256i s0 = _mm256_setzero_si256();
+    __m256i s1 = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 16 <= length; i += 16) {
+        s0 = _mm256_add_epi32(s0, _mm256_mullo_epi32(_mm256_load_si256((const __m256i *)(a + i)),
+                                                     _mm256_load_si256((const __m256i *)(b + i))));
+        s1 = _mm256_add_epi32(s1, _mm256_mullo_epi32(_mm256_load_si256((const __m256i *)(a + i + 8)),
+                                                     _mm256_load_si256((const __m256i *)(b + i + 8))));
+    }
+    unsigned int total = (unsigned int)horizontal_sum_avx2(_mm256_add_epi32(s0, s1));
+    return (int)(total + (unsigned int)dot_scalar(a + i, b + i, length - i));
+}
+
+__attribute__((target("avx2"))) void add_avx2(int *dst, const int *a, const int *b, int length) {
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m256i x = _mm256_load_si256((const __m256i *)(a + i));
+        __m256i y = _mm256_load_si256((const __m256i *)(b + i));
+        _mm256_store_si256((__m256i *)(dst + i), _mm256_add_epi32(x, y));
+    }
+    add_scalar(dst + i, a + i, b + i, length - i);
+}
+
+__attribute__((target("avx2"))) void mul_avx2(int *dst, const int *a, const int *b, int length) {
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m256i x = _mm256_load_si256((const __m256i *)(a + i));
+        __m256i y = _mm256_load_si256((const __m256i *)(b + i));
+        _mm256_store_si256((__m256i *)(dst + i), _mm256_mullo_epi32(x, y));
+    }
+    mul_scalar(dst + i, a + i, b + i, length - i);
+}
+
+__attribute__((target("avx2"))) int min_avx2(const int *a, int length) {
+    if (length < 8) {
+        return min_scalar(a, length);
+    }
+    __m256i m = _mm256_load_si256((const __m256i *)a);
+    int i = 8;
+    for (; i + 8 <= length; i += 8) {
+        m = _mm256_min_epi32(m, _mm256_load_si256((const __m256i *)(a + i)));
+    }
+    int lanes[8];
+    _mm256_storeu_si256((__m256i *)lanes, m);
+    int result = min_scalar(lanes, 8);
+    if (i < length) {
+        int tail = min_scalar(a + i, length - i);
+        result = tail < result ? tail : result;
+    }
+    return result;
+}
+
+__attribute__((target("avx2"))) int max_avx2(const int *a, int length) {
+    if (length < 8) {
+        return max_scalar(a, length);
+    }
+    __m256i m = _mm256_load_si256((const __m256i *)a);
+    int i = 8;
+    for (; i + 8 <= length; i += 8) {
+        m = _mm256_max_epi32(m, _mm256_load_si256((const __m256i *)(a + i)));
+    }
+    int lanes[8];
+    _mm256_storeu_si256((__m256i *)lanes, m);
+    int result = max_scalar(lanes, 8);
+    if (i < length) {
+        int tail = max_scalar(a + i, length - i);
+        result = tail > result ? tail : result;
+    }
+    return result;
+}
+#endif
+
+// 当前使用的内核，select_array_kernels 按 CPU 特性选择
+void (*fill_kernel)(int *, int, int) = fill_scalar;
+int (*sum_kernel)(const int *, int) = sum_scalar;
+int (*dot_kernel)(const int *, const int *, int) = dot_scalar;
+void (*add_kernel)(int *, const int *, const int *, int) = add_scalar;
+void (*mul_kernel)(int *, const int *, const int *, int) = mul_scalar;
+int (*min_kernel)(const int *, int) = min_scalar;
+int (*max_kernel)(const int *, int) = max_scalar;
+
+void select_array_kernels() {
+#ifdef HAVE_AVX2_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        fill_kernel = fill_avx2;
+        sum_kernel = sum_avx2;
+        dot_kernel = dot_avx2;
+        add_kernel = add_avx2;
+        mul_kernel = mul_avx2;
+        min_kernel = min_avx2;
+        max_kernel = max_avx2;
+    }
+#endif
+}
+
+// 把内置函数的参数按源码顺序放入 out（参数链表是逆序的），并检查个数
+void builtin_args(const char *name, Node *args, Node **out, int count) {
+    int n = 0;
+    for (Node *arg = args; arg != NULL; arg = arg->next) {
+        if (n < count) {
+            out[count - 1 - n] = arg;
+        }
+        n++;
+    }
+    if (n != count) {
+        fatal_error("Error: %s expects %d arguments", name, count);
+    }
+}
+
+// 数组参数必须直接写数组名
+Array *array_arg(const char *name, Node *arg, Scope *scope) {
+    if (arg->type != NODE_IDENTIFIER) {
+        fatal_error("Error: %s expects an array name", name);
+    }
+    return find_array(scope, arg->name);
+}
+
+void check_same_length(const char *name, Array *a, Array *b) {
+    if (a->length != b->length) {
+        fatal_error("Error: Array length mismatch in %s: %d and %d", name, a->length, b->length);
+    }
+}
+
+// fill(a, v)：所有元素置为 v
+int builtin_fill(Node *args, Scope *scope) {
+    Node *arg[2];
+    builtin_args("fill", args, arg, 2);
+    Array *dst = array_arg("fill", arg[0], scope);
+    fill_kernel(dst->data, dst->length, evaluate(arg[1], scope));
+    return dst->length;
+}
+
+// copy(dst, src)：两个数组长度相同，允许是同一个数组
+int builtin_copy(Node *args, Scope *scope) {
+    Node *arg[2];
+    builtin_args("copy", args, arg, 2);
+    Array *dst = array_arg("copy", arg[0], scope);
+    Array *src = array_arg("copy", arg[1], scope);
+    check_same_length("copy", dst, src);
+    memmove(dst->data, src->data, sizeof(int) * dst->length);
+    return dst->length;
+}
+
+int builtin_sum(Node *args, Scope *scope) {
+    Node *arg[1];
+    builtin_args("sum", args, arg, 1);
+    Array *a = array_arg("sum", arg[0], scope);
+    return sum_kernel(a->data, a->length);
+}
+
+int builtin_dot(Node *args, Scope *scope) {
+    Node *arg[2];
+    builtin_args("dot", args, arg, 2);
+    Array *a = array_arg("dot", arg[0], scope);
+    Array *b = array_arg("dot", arg[1], scope);
+    check_same_length("dot", a, b);
+    return dot_kernel(a->data, b->data, a->length);
+}
+
+// add(dst, a, b) / mul(dst, a, b)：逐元素运算，dst 可以与 a、b 相同
+int builtin_add(Node *args, Scope *scope) {
+    Node *arg[3];
+    builtin_args("add", args, arg, 3);
+    Array *dst = array_arg("add", arg[0], scope);
+    Array *a = array_arg("add", arg[1], scope);
+    Array *b = array_arg("add", arg[2], scope);
+    check_same_length("add", dst, a);
+    check_same_length("add", a, b);
+    add_kernel(dst->data, a->data, b->data, dst->length);
+    return dst->length;
+}
+
+int builtin_mul(Node *args, Scope *scope) {
+    Node *arg[3];
+    builtin_args("mul", args, arg, 3);
+    Array *dst = array_arg("mul", arg[0], scope);
+    Array *a = array_arg("mul", arg[1], scope);
+    Array *b = array_arg("mul", arg[2], scope);
+    check_same_length("mul", dst, a);
+    check_same_length("mul", a, b);
+    mul_kernel(dst->data, a->data, b->data, dst->length);
+    return dst->length;
+}
+
+// min / max：一个参数时是数组的最小/最大元素，两个参数时比较两个整数
+int builtin_min(Node *args, Scope *scope) {
+    if (args != NULL && args->next != NULL) {
+        Node *arg[2];
+        builtin_args("min", args, arg, 2);
+        int a = evaluate(arg[0], scope);
+        int b = evaluate(arg[1], scope);
+        return a < b ? a : b;
+    }
+    Node *arg[1];
+    builtin_args("min", args, arg, 1);
+    Array *a = array_arg("min", arg[0], scope);
+    if (a->length == 0) {
+        fatal_error("Error: min of empty array %s", arg[0]->name);
+    }
+    return min_kernel(a->data, a->length);
+}
+
+int builtin_max(Node *args, Scope *scope) {
+    if (args != NULL && args->next != NULL) {
+        Node *arg[2];
+        builtin_args("max", args, arg, 2);
+        int a = evaluate(arg[0], scope);
+        int b = evaluate(arg[1], scope);
+        return a > b ? a : b;
+    }
+    Node *arg[1];
+    builtin_args("max", args, arg, 1);
+    Array *a = array_arg("max", arg[0], scope);
+    if (a->length == 0) {
+        fatal_error("Error: max of empty array %s", arg[0]->name);
+    }
+    return max_kernel(a->data, a->length);
+}
+
+int builtin_len(Node *args, Scope *scope) {
+    Node *arg[1];
+    builtin_args("len", args, arg, 1);
+    return array_arg("len", arg[0], scope)->length;
+}
+
+// 整数内置函数：与标量运算一样按 32 位回绕
+int builtin_abs(Node *args, Scope *scope) {
+    Node *arg[1];
+    builtin_args("abs", args, arg, 1);
+    int x = evaluate(arg[0], scope);
+    return x < 0 ? (int)(0u - (unsigned int)x) : x;
+}
+
+// pow(b, e)：平方求幂，e 必须非负
+int builtin_pow(Node *args, Scope *scope) {
+    Node *arg[2];
+    builtin_args("pow", args, arg, 2);
+    unsigned int base = (unsigned int)evaluate(arg[0], scope);
+    int exponent = evaluate(arg[1], scope);
+    if (exponent < 0) {
+        fatal_error("Error: pow exponent must be non-negative");
+    }
+    unsigned int result = 1;
+    while (exponent > 0) {
+        if (exponent & 1) {
+            result *= base;
+        }
+        base *= base;
+        exponent >>= 1;
+    }
+    return (int)result;
+}
+
+// mod(a, b)：与 C 的 % 相同，结果符号跟随 a
+int builtin_mod(Node *args, Scope *scope) {
+    Node *arg[2];
+    builtin_args("mod", args, arg, 2);
+    int a = evaluate(arg[0], scope);
+    int b = evaluate(arg[1], scope);
+    if (b == 0) {
+        fatal_error("Error: Division by zero");
+    }
+    if (b == -1) {
+        return 0;
+    }
+    return a % b;
+}
+
+// gcd(a, b)：非负的最大公约数，gcd(0, 0) = 0
+int builtin_gcd(Node *args, Scope *scope) {
+    Node *arg[2];
+    builtin_args("gcd", args, arg, 2);
+    int a = evaluate(arg[0], scope);
+    int b = evaluate(arg[1], scope);
+    unsigned int x = a < 0 ? 0u - (unsigned int)a : (unsigned int)a;
+    unsigned int y = b < 0 ? 0u - (unsigned int)b : (unsigned int)b;
+    while (y != 0) {
+        unsigned int t = x % y;
+        x = y;
+        y = t;
+    }
+    return (int)x;
+}
+
+// popcount(x)：二进制表示中 1 的个数，负数按 32 位补码计算
+int builtin_popcount(Node *args, Scope *scope) {
+    Node *arg[1];
+    builtin_args("popcount", args, arg, 1);
+    unsigned int x = (unsigned int)evaluate(arg[0], scope);
+#ifdef __GNUC__
+    return __builtin_popcount(x);
+#else
+    int count = 0;
+    for (; x != 0; x &= x - 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+// 调用原生函数：参数按源码顺序求值，参数不多时放在栈上
+int call_native(Function *func, Node *args, Scope *scope) {
+    int count = 0;
+    for (Node *arg = args; arg != NULL; arg = arg->next) {
+        count++;
+    }
+    int stack_values[16];
+    int *values = count <= 16 ? stack_values : (int *)malloc(sizeof(int) * count);
+    if (values == NULL) {
+        fatal_error("Error: Out of memory");
+    }
+    int i = count;
+    for (Node *arg = args; arg != NULL; arg = arg->next) {
+        values[--i] = evaluate(arg, scope);
+    }
+    int result = func->native(values, count);
+    if (values != stack_values) {
+        free(values);
+    }
+    return result;
+}
+
+// 登记内置函数；程序中同名的 def 会覆盖它们
+void register_builtins() {
+    add_builtin("fill", builtin_fill, 1);
+    add_builtin("copy", builtin_copy, 1);
+    add_builtin("sum", builtin_sum, 0);
+    add_builtin("dot", builtin_dot, 0);
+    add_builtin("add", builtin_add, 1);
+    add_builtin("mul", builtin_mul, 1);
+    add_builtin("min", builtin_min, 0);
+    add_builtin("max", builtin_max, 0);
+    add_builtin("len", builtin_len, 0);
+    add_builtin("abs", builtin_abs, 0);
+    add_builtin("pow", builtin_pow, 0);
+    add_builtin("mod", builtin_mod, 0);
+    add_builtin("gcd", builtin_gcd, 0);
+    add_builtin("popcount", builtin_popcount, 0);
+}
+
+// 首次调用延迟解析的函数时解析其函数体
+void parse_lazy_function(Function *func) {
+    Node *def = func->def;
+    Token *saved_tokens = tokens;
+    int saved_current = current_token;
+    jmp_buf *saved_jmp = error_jmp;
+    jmp_buf env;
+    
+    // 解析出错时先恢复标记数组，再交给外层处理
+    error_jmp = &env;
+    tokens = def->lazy_tokens;
+    current_token = 0;
+    if (setjmp(env) == 0) {
+        parse_function_body(def);
+    } else {
+        tokens = saved_tokens;
+        current_token = saved_current;
+        error_jmp = saved_jmp;
+        def->body = NULL;
+        def->return_expr = NULL;
+        rethrow_error();
+    }
+    tokens = saved_tokens;
+    current_token = saved_current;
+    error_jmp = saved_jmp;
+    report_node_count();
+    
+    def->lazy_tokens = NULL;
+    func->body = def->body;
+    func->return_expr = def->return_expr;
+}
+
+// 查找函数
+Function *find_function(const char *name) {
+    if (function_count > 0) {
+        int *slot = function_slot(name);
+        if (*slot != 0) {
+            Function *func = &functions[*slot - 1];
+            if (func->def != NULL && func->def->lazy_tokens != NULL) {
+                parse_lazy_function(func);
+            }
+            return func;
+        }
+    }
+    
+    fatal_error("Error: Function not defined: %s", name);
+}
+
+// 计算表达式
+int evaluate(Node *node, Scope *scope) {
+    if (node == NULL) {
+        return 0;
+    }
+    
+    switch (node->type) {
+        case NODE_NUMBER:
+            return node->value;
+        case NODE_IDENTIFIER:
+            return find_variable(scope, node->name);
+        case NODE_INDEX_EXPR:
+            return *array_element(scope, node->name, evaluate(node->left, scope));
+        case NODE_BINARY_OP:
+            {
+                int left = evaluate(node->left, scope);
+                int right = evaluate(node->right, scope);
+                
+                if (strcmp(node->name, "+") == 0) {
+                    return left + right;
+                } else if (strcmp(node->name, "-") == 0) {
+                    return left - right;
+                } else if (strcmp(node->name, "*") == 0) {
+                    return left * right;
+                } else if (strcmp(node->name, "/") == 0) {
+                    if (right == 0) {
+                        fatal_error("Error: Division by zero");
+                    }
+                    return left / right;
+                } else if (strcmp(node->name, "==") == 0) {
+                    return left == right;
+                } else if (strcmp(node->name, "!=") == 0) {
+                    return left != right;
+                } else if (strcmp(node->name, "<") == 0) {
+                    return left < right;
+                } else if (strcmp(node->name, ">") == 0) {
+                    return left > right;
+                } else if (strcmp(node->name, "<=") == 0) {
+                    return left <= right;
+                } else if (strcmp(node->name, ">=") == 0) {
+                    return left >= right;
+                }
+            }
+        case NODE_FUNCTION_CALL_EXPR:
+            {
+                Function *func = find_function(node->name);
+                if (func->builtin != NULL) {
+                    return func->builtin(node->args, scope);
+                }
+                if (func->native != NULL) {
+                    return call_native(func, node->args, scope);
+                }
+                Scope local_scope = {{}, {}, 0, scope, {}};
+                Frame frame = {&local_scope, NULL};
+                COUNT_STEP();
+                enter_frame(&frame);
+                
+                // 绑定参数
+                Node *param = func->params;
+                Node *arg = node->args;
+                while (param != NULL && arg != NULL) {
+                    set_variable(&local_scope, param->name, evaluate(arg, scope));
+                    param = param->next;
+                    arg = arg->next;
+                }
+                
+                // 执行函数体（interpret 会依次执行整条语句链）
+                TRACE(TRACE_ENTER, node->line, func - functions);
+                interpret(func->body, &local_scope);
+                
+                // 返回值
+                int result = evaluate(func->return_expr, &local_scope);
+                leave_frame(&frame);
+                TRACE(TRACE_EXIT, node->line, func - functions);
+                return result;
+            }
+        case NODE_INPUT_EXPR:
+            {
+                int value = 0;
+                if (input_hook != NULL) {
+                    if (!input_hook(&value)) {
+                        fatal_error("Error: No input available");
+                    }
+                    return value;
+                }
+                printf("Input: ");
+                scanf("%d", &value);
+                return value;
+            }
+        default:
+            return 0;
+    }
+}
+
+// parfor 循环体检查的状态；每次检查独立，嵌套的 parfor 可以在工作线程上同时检查
+typedef struct {
+    const char *loop_var;
+    const char *reduce_var;
+    int reduce_kind;
+    const char **declared;
+    int declared_count;
+    int declared_capacity;
+    // 已经检查过的被调用函数
+    const char **checked;
+    int checked_count;
+    int checked_capacity;
+    int in_function;
+    // 当前正在检查的被调用函数
+    const char *function;
+    // 被调用函数的参数和其中声明或赋值的名字，local_base 之后属于当前正在检查的函数
+    const char **locals;
+    int local_count;
+    int local_capacity;
+    int local_base;
+    // 以循环变量为下标写入的共享数组，以及以其他方式读取的共享数组
+    const char **sliced;
+    int sliced_count;
+    int sliced_capacity;
+    const char **shared_reads;
+    int shared_read_count;
+    int shared_read_capacity;
+} ParforCheck;
+
+int name_in(const char **names, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(names[i], name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void add_name(const char ***names, int *count, int *capacity, const char *name) {
+    if (name_in(*names, *count, name)) {
+        return;
+    }
+    if (*count >= *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 16;
+        *names = (const char **)realloc(*names, sizeof(char *) * *capacity);
+        if (*names == NULL) {
+            fatal_error("Error: Out of memory");
+        }
+    }
+    (*names)[(*count)++] = name;
+}
+
+// 循环体内声明的名字是每次迭代私有的；不能重新声明循环变量或归约变量，否则它们被遮蔽，
+// 之后按下标写入共享数组的检查会把私有变量误当成循环变量
+void declare_private(ParforCheck *check, const char *name) {
+    if (strcmp(name, check->loop_var) == 0 ||
+        (check->reduce_var != NULL && strcmp(name, check->reduce_var) == 0)) {
+        fatal_error("Error: parfor body must not redeclare %s", name);
+    }
+    add_name(&check->declared, &check->declared_count, &check->declared_capacity, name);
+}
+
+// 被调用函数的局部名字；外层函数可能已有同名的局部名字，只在当前函数的部分中去重
+void declare_local(ParforCheck *check, const char *name) {
+    if (name_in(check->locals + check->local_base, check->local_count - check->local_base, name)) {
+        return;
+    }
+    if (check->local_count >= check->local_capacity) {
+        check->local_capacity = check->local_capacity ? check->local_capacity * 2 : 16;
+        check->locals = (const char **)realloc(check->locals, sizeof(char *) * check->local_capacity);
+        if (check->locals == NULL) {
+            fatal_error("Error: Out of memory");
+        }
+    }
+    check->locals[check->local_count++] = name;
+}
+
+// 名字在当前位置指向循环私有的数组或变量：循环体里声明的，或被调用函数自己的局部名字
+int array_is_private(ParforCheck *check, const char *name) {
+    if (check->in_function) {
+        return name_in(check->locals + check->local_base, check->local_count - check->local_base, name);
+    }
+    return name_in(check->declared, check->declared_count, name);
+}
+
+// 读取数组：只有循环体中以循环变量为下标的读取可以与按同样下标的写入并存
+void check_parfor_read(ParforCheck *check, const char *name, Node *index) {
+    if (array_is_private(check, name)) {
+        return;
+    }
+    if (!check->in_function && index != NULL && index->type == NODE_IDENTIFIER &&
+        strcmp(index->name, check->loop_var) == 0) {
+        return;
+    }
+    add_name(&check->shared_reads, &check->shared_read_count, &check->shared_read_capacity, name);
+}
+
+// 归约变量在循环体中只能出现在自己的更新语句左侧，其他位置读到的只是部分结果；
+// 作用域是动态的，被调用函数读到的同名变量若不是自己的局部变量，也是归约变量的部分结果
+void check_reduce_read(ParforCheck *check, const char *name) {
+    if (check->reduce_var == NULL || strcmp(name, check->reduce_var) != 0) {
+        return;
+    }
+    if (!check->in_function) {
+        fatal_error("Error: parfor body reads reduction variable %s outside its update", name);
+    }
+    if (!array_is_private(check, name)) {
+        fatal_error("Error: parfor body calls %s, which reads reduction variable %s", check->function, name);
+    }
+}
+
+int is_name(Node *node, const char *name) {
+    return node != NULL && node->type == NODE_IDENTIFIER && strcmp(node->name, name) == 0;
+}
+
+void free_parfor_check(ParforCheck *check) {
+    free(check->declared);
+    free(check->checked);
+    free(check->locals);
+    free(check->sliced);
+    free(check->shared_reads);
+}
+
+void check_parfor_function(ParforCheck *check, Function *func);
+void check_parfor_call(ParforCheck *check, Node *node);
+
+// 检查单个表达式：不允许 input，被调用的函数递归检查
+void check_parfor_node(ParforCheck *check, Node *node) {
+    if (node == NULL) {
+        return;
+    }
+    switch (node->type) {
+        case NODE_INPUT_EXPR:
+            fatal_error("Error: parfor body must not call input");
+        case NODE_IDENTIFIER:
+            check_reduce_read(check, node->name);
+            break;
+        case NODE_BINARY_OP:
+            check_parfor_node(check, node->left);
+            check_parfor_node(check, node->right);
+            break;
+        case NODE_INDEX_EXPR:
+            check_parfor_node(check, node->left);
+            check_parfor_read(check, node->name, node->left);
+            break;
+        case NODE_FUNCTION_CALL_EXPR:
+            check_parfor_call(check, node);
+            break;
+        default:
+            break;
+    }
+}
+
+// 检查表达式及通过 next 相连的参数列表
+void check_parfor_expr(ParforCheck *check, Node *node) {
+    for (; node != NULL; node = node->next) {
+        check_parfor_node(check, node);
+    }
+}
+
+// 检查函数调用；内置函数按名字接收数组，写入的第一个参数必须是私有数组，其余数组按整体读取
+void check_parfor_call(ParforCheck *check, Node *node) {
+    Function *func = find_function(node->name);
+    if (func->builtin == NULL) {
+        check_parfor_expr(check, node->args);
+        check_parfor_function(check, func);
+        return;
+    }
+    for (Node *arg = node->args; arg != NULL; arg = arg->next) {
+        if (arg->type != NODE_IDENTIFIER) {
+            check_parfor_node(check, arg);
+        } else if (func->writes_array && arg->next == NULL) {
+            // 参数链表是逆序的，最后一项是第一个参数
+            if (!array_is_private(check, arg->name)) {
+                fatal_error("Error: parfor body writes shared array %s", arg->name);
+            }
+        } else {
+            check_reduce_read(check, arg->name);
+            check_parfor_read(check, arg->name, NULL);
+        }
+    }
+}
+
+// 归约变量的更新必须与归约方式一致，各块的部分结果才能合并：
+// sum(t) 只能写成 t = t + e1 - e2 ...，min(t) / max(t) 只能写成 t = min(t, e) / t = max(t, e)，e 中不能读取 t
+void check_reduce_update(ParforCheck *check, Node *node) {
+    const char *name = node->name;
+    Node *value = node->right;
+    if (check->reduce_kind == REDUCE_SUM) {
+        // 沿加减法的左侧下降，直到最左边的 t
+        while (value->type == NODE_BINARY_OP && (strcmp(value->name, "+") == 0 || strcmp(value->name, "-") == 0)) {
+            check_parfor_node(check, value->right);
+            if (is_name(value->left, name)) {
+                return;
+            }
+            value = value->left;
+        }
+        fatal_error("Error: parfor reduction sum(%s) must be updated as %s = %s + expr", name, name, name);
+    }
+    
+    const char *op = check->reduce_kind == REDUCE_MIN ? "min" : "max";
+    // 参数链表是逆序的：args->next 是第一个参数
+    if (value->type == NODE_FUNCTION_CALL_EXPR && strcmp(value->name, op) == 0 &&
+        find_function(op)->builtin != NULL && value->args != NULL && value->args->next != NULL &&
+        value->args->next->next == NULL && is_name(value->args->next, name)) {
+        check_parfor_node(check, value->args);
+        return;
+    }
+    fatal_error("Error: parfor reduction %s(%s) must be updated as %s = %s(%s, expr)", op, name, name, op, name);
+}
+
+// 检查语句链；in_function 为真时位于被调用函数内，赋值只写函数自己的作用域
+void check_parfor_stmts(ParforCheck *check, Node *node, int in_function) {
+    for (; node != NULL; node = node->next) {
+        switch (node->type) {
+            case NODE_VAR_DECL:
+                check_parfor_expr(check, node->right);
+                if (in_function) {
+                    declare_local(check, node->name);
+                } else {
+                    declare_private(check, node->name);
+                }
+                break;
+            case NODE_ASSIGNMENT:
+                if (!in_function && check->reduce_var != NULL && strcmp(node->name, check->reduce_var) == 0) {
+                    check_reduce_update(check, node);
+                    break;
+                }
+                check_parfor_expr(check, node->right);
+                if (in_function) {
+                    // 赋值写入函数自己的作用域，之后读到的是局部变量
+                    declare_local(check, node->name);
+                } else {
+                    if (strcmp(node->name, check->loop_var) == 0) {
+                        fatal_error("Error: parfor body must not assign the loop variable %s", node->name);
+                    }
+                    if ((check->reduce_var == NULL || strcmp(node->name, check->reduce_var) != 0) &&
+                        !name_in(check->declared, check->declared_count, node->name)) {
+                        fatal_error("Error: parfor body writes shared variable %s", node->name);
+                    }
+                }
+                break;
+            case NODE_IF_STMT:
+                check_parfor_expr(check, node->left);
+                check_parfor_stmts(check, node->body, in_function);
+                check_parfor_stmts(check, node->else_body, in_function);
+                break;
+            case NODE_FOR_STMT:
+            case NODE_PARFOR_STMT:
+                check_parfor_stmts(check, node->left, in_function);
+                check_parfor_expr(check, node->right);
+                check_parfor_stmts(check, node->else_body, in_function);
+                check_parfor_stmts(check, node->body, in_function);
+                if (node->type == NODE_PARFOR_STMT && node->value != REDUCE_NONE && !in_function &&
+                    !name_in(check->declared, check->declared_count, node->name)) {
+                    fatal_error("Error: parfor body writes shared variable %s", node->name);
+                }
+                break;
+            case NODE_ARRAY_DECL:
+                check_parfor_expr(check, node->left);
+                if (in_function) {
+                    declare_local(check, node->name);
+                } else {
+                    declare_private(check, node->name);
+                }
+                break;
+            case NODE_INDEX_ASSIGN:
+                check_parfor_expr(check, node->left);
+                check_parfor_expr(check, node->right);
+                if (!array_is_private(check, node->name)) {
+                    // 共享数组只能写入以循环变量为下标的元素，各迭代互不重叠
+                    if (in_function || node->left->type != NODE_IDENTIFIER ||
+                        strcmp(node->left->name, check->loop_var) != 0) {
+                        fatal_error("Error: parfor body writes shared array %s", node->name);
+                    }
+                    add_name(&check->sliced, &check->sliced_count, &check->sliced_capacity, node->name);
+                }
+                break;
+            case NODE_FUNCTION_CALL:
+                check_parfor_call(check, node);
+                break;
+            case NODE_PRINT_STMT:
+                fatal_error("Error: parfor body must not call print");
+            default:
+                break;
+        }
+    }
+}
+
+// 被调用函数检查 print / input、数组写入和归约变量的读取，每次检查中每个函数只看一遍
+void check_parfor_function(ParforCheck *check, Function *func) {
+    if (name_in(check->checked, check->checked_count, func->name)) {
+        return;
+    }
+    add_name(&check->checked, &check->checked_count, &check->checked_capacity, func->name);
+    int saved_base = check->local_base;
+    int saved_count = check->local_count;
+    const char *saved_function = check->function;
+    check->local_base = check->local_count;
+    check->function = func->name;
+    for (Node *param = func->params; param != NULL; param = param->next) {
+        declare_local(check, param->name);
+    }
+    check->in_function++;
+    check_parfor_stmts(check, func->body, 1);
+    check_parfor_expr(check, func->return_expr);
+    check->in_function--;
+    check->local_base = saved_base;
+    check->local_count = saved_count;
+    check->function = saved_function;
+}
+
+// 循环边界和步长必须只读取循环中不会写入的变量，且没有函数调用和输入
+void check_parfor_bound(ParforCheck *check, Node *node) {
+    if (node == NULL) {
+        return;
+    }
+    switch (node->type) {
+        case NODE_IDENTIFIER:
+            if (strcmp(node->name, check->loop_var) == 0 ||
+                (check->reduce_var != NULL && strcmp(node->name, check->reduce_var) == 0) ||
+                name_in(check->declared, check->declared_count, node->name)) {
+                fatal_error("Error: parfor bound depends on %s, which the loop writes", node->name);
+            }
+            break;
+        case NODE_BINARY_OP:
+            check_parfor_bound(check, node->left);
+            check_parfor_bound(check, node->right);
+            break;
+        case NODE_NUMBER:
+            break;
+        default:
+            fatal_error("Error: parfor bounds must not read arrays, call functions or input");
+    }
+}
+
+// 一次 parfor 执行：迭代区间按块切分成任务
+typedef struct {
+    Node *node;
+    Scope *scope;
+    long long start;
+    long long step;
+    long long count;
+    long long grain;
+    int *partials;
+    // 串行执行时沿用调用者的计步（调度器的协程中，或嵌套在另一个 parfor 的块中）
+    int inline_run;
+    // 有步数上限时各线程共享的剩余步数，每次领取 PARFOR_STEP_BATCH 步
+    int limited;
+    long long budget;
+    int out_of_steps;
+    int failed;
+    int error_index;
+    char error[ERROR_MESSAGE_SIZE];
+    pthread_mutex_t error_lock;
+} ParforJob;
+
+int reduce_identity(int kind) {
+    return kind == REDUCE_MIN ? INT_MAX : kind == REDUCE_MAX ? INT_MIN : 0;
+}
+
+int reduce_combine(int kind, int a, int b) {
+    switch (kind) {
+        case REDUCE_SUM:
+            return (int)((unsigned int)a + (unsigned int)b);
+        case REDUCE_MIN:
+            return a < b ? a : b;
+        case REDUCE_MAX:
+            return a > b ? a : b;
+        default:
+            return a;
+    }
+}
+
+#define PARFOR_STEP_BATCH 1024
+
+THREAD_LOCAL ParforJob *parfor_job = NULL;
+// 本块因步数用完或其他块出错而停止，不记录错误信息
+THREAD_LOCAL int parfor_stopped = 0;
+
+// 工作线程的步数预算用完：从共享预算中再领取一批；共享预算用完或其他块已出错时停止本块
+void parfor_step_hook() {
+    ParforJob *job = parfor_job;
+    if (__atomic_load_n(&job->failed, __ATOMIC_RELAXED)) {
+        parfor_stopped = 1;
+        fatal_error("Error: parfor aborted");
+    }
+    long long left = __atomic_load_n(&job->budget, __ATOMIC_RELAXED);
+    long long take;
+    do {
+        if (left <= 0) {
+            __atomic_store_n(&job->out_of_steps, 1, __ATOMIC_RELAXED);
+            parfor_stopped = 1;
+            fatal_error("Error: parfor step budget exhausted");
+        }
+        take = left < PARFOR_STEP_BATCH ? left : PARFOR_STEP_BATCH;
+    } while (!__atomic_compare_exchange_n(&job->budget, &left, left - take, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    // 触发本钩子的那一步若还没有扣除（预算已减到负数），从新领取的步数中扣除
+    step_budget += take;
+}
+
+// 执行一块迭代；每块有自己的私有作用域，父作用域只读
+void parfor_task(void *context, int index) {
+    ParforJob *job = (ParforJob *)context;
+    if (__atomic_load_n(&job->failed, __ATOMIC_RELAXED)) {
+        return;
+    }
+    
+    Node *node = job->node;
+    long long first = (long long)index * job->grain;
+    long long last = first + job->grain < job->count ? first + job->grain : job->count;
+    Scope local_scope = {{0}, {0}, 0, job->scope, {0}};
+    jmp_buf *saved_jmp = error_jmp;
+    char *saved_message = error_message;
+    long long saved_budget = step_budget;
+    void (*saved_hook)(void) = step_hook;
+    ParforJob *saved_job = parfor_job;
+    int saved_depth = call_depth;
+    Frame *saved_mark = unwind_mark;
+    char message[ERROR_MESSAGE_SIZE];
+    jmp_buf env;
+    
+    // 串行执行时沿用调用者的计步；否则循环体从共享预算领取步数，没有上限时不计步
+    error_jmp = &env;
+    error_message = message;
+    unwind_mark = frame_top;
+    parfor_stopped = 0;
+    if (!job->inline_run) {
+        parfor_job = job;
+        step_budget = job->limited ? 0 : LLONG_MAX;
+        step_hook = job->limited ? parfor_step_hook : NULL;
+    }
+    if (setjmp(env) == 0) {
+        if (node->value != REDUCE_NONE) {
+            set_variable(&local_scope, node->name, reduce_identity(node->value));
+        }
+        for (long long k = first; k < last; k++) {
+            set_variable(&local_scope, node->left->name, (int)(job->start + k * job->step));
+            interpret(node->else_body, &local_scope);
+            // 与 for 一样，每次迭代的回边记一步
+            COUNT_STEP();
+        }
+        if (node->value != REDUCE_NONE) {
+            job->partials[index] = find_variable(&local_scope, node->name);
+        }
+        release_arrays(&local_scope);
+    } else {
+        // 记录迭代顺序上最靠前的错误，其余任务尽快停止
+        pthread_mutex_lock(&job->error_lock);
+        if (!parfor_stopped && (!job->failed || index < job->error_index)) {
+            memcpy(job->error, message, sizeof(message));
+            job->error_index = index;
+        }
+        __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&job->error_lock);
+        release_arrays(&local_scope);
+    }
+    if (!job->inline_run) {
+        // 归还本块没用完的步数
+        if (job->limited && step_budget > 0) {
+            __atomic_fetch_add(&job->budget, step_budget, __ATOMIC_RELAXED);
+        }
+        step_budget = saved_budget;
+        step_hook = saved_hook;
+        parfor_job = saved_job;
+    }
+    error_jmp = saved_jmp;
+    error_message = saved_message;
+    unwind_mark = saved_mark;
+    call_depth = saved_depth;
+}
+
+// 并行 for：检查循环体，把迭代区间分给线程池，每块使用私有作用域，最后按块顺序归约
+void execute_parfor(Node *node, Scope *scope) {
+    Node *init = node->left;
+    Node *cond = node->right;
+    Node *inc = node->body;
+    
+    // 循环必须是 i = a; i op b; i = i +/- c 的形式，op 只能是 < <= > >= !=，迭代次数按这些比较计算
+    if (init == NULL || init->right == NULL || cond == NULL || cond->type != NODE_BINARY_OP ||
+        cond->left == NULL || cond->left->type != NODE_IDENTIFIER || strcmp(cond->left->name, init->name) != 0 ||
+        (strcmp(cond->name, "<") != 0 && strcmp(cond->name, "<=") != 0 && strcmp(cond->name, ">") != 0 &&
+         strcmp(cond->name, ">=") != 0 && strcmp(cond->name, "!=") != 0) ||
+        inc == NULL || strcmp(inc->name, init->name) != 0 || inc->right == NULL || inc->right->type != NODE_BINARY_OP ||
+        (strcmp(inc->right->name, "+") != 0 && strcmp(inc->right->name, "-") != 0) ||
+        inc->right->left == NULL || inc->right->left->type != NODE_IDENTIFIER ||
+        strcmp(inc->right->left->name, init->name) != 0) {
+        fatal_error("Error: parfor loop must have the form (int i = a; i < b; i = i + c)");
+    }
+    
+    // 检查循环体
+    ParforCheck check;
+    memset(&check, 0, sizeof(check));
+    check.loop_var = init->name;
+    check.reduce_var = node->value != REDUCE_NONE ? node->name : NULL;
+    check.reduce_kind = node->value;
+    jmp_buf *saved_jmp = error_jmp;
+    jmp_buf env;
+    error_jmp = &env;
+    if (setjmp(env) != 0) {
+        error_jmp = saved_jmp;
+        free_parfor_check(&check);
+        rethrow_error();
+    }
+    check_parfor_expr(&check, init->right);
+    check_parfor_stmts(&check, node->else_body, 0);
+    check_parfor_bound(&check, cond->right);
+    check_parfor_bound(&check, inc->right->right);
+    for (int i = 0; i < check.sliced_count; i++) {
+        if (name_in(check.shared_reads, check.shared_read_count, check.sliced[i])) {
+            fatal_error("Error: parfor body reads %s at an index other than the loop variable", check.sliced[i]);
+        }
+    }
+    error_jmp = saved_jmp;
+    free_parfor_check(&check);
+    
+    // 计算迭代次数
+    long long start = evaluate(init->right, scope);
+    long long bound = evaluate(cond->right, scope);
+    long long step = evaluate(inc->right->right, scope);
+    if (strcmp(inc->right->name, "-") == 0) {
+        step = -step;
+    }
+    const char *op = cond->name;
+    long long count = 0;
+    int runs = (strcmp(op, "<") == 0 && start < bound) || (strcmp(op, "<=") == 0 && start <= bound) ||
+               (strcmp(op, ">") == 0 && start > bound) || (strcmp(op, ">=") == 0 && start >= bound) ||
+               (strcmp(op, "!=") == 0 && start != bound);
+    if (runs) {
+        long long distance = bound - start;
+        if (step == 0 || (distance > 0) != (step > 0) ||
+            (strcmp(op, "!=") == 0 && distance % step != 0)) {
+            fatal_error("Error: parfor loop does not terminate");
+        }
+        if (strcmp(op, "<=") == 0 || strcmp(op, ">=") == 0) {
+            count = distance / step + 1;
+        } else {
+            count = (distance + step - (step > 0 ? 1 : -1)) / step;
+        }
+    }
+    
+    // 按块切分，每个线程约 64 块，供窃取时平衡负载
+    // parfor_threads 在启动时确定；工作线程上的嵌套 parfor 不启动线程，pool_run 会串行执行它
+    if (!in_pool_task) {
+        pool_start(parfor_threads);
+    }
+    int participants = parfor_threads < pool_workers + 1 ? parfor_threads : pool_workers + 1;
+    long long tasks = (long long)participants * 64;
+    if (tasks > count) {
+        tasks = count;
+    }
+    
+    ParforJob job;
+    job.node = node;
+    job.scope = scope;
+    job.start = start;
+    job.step = step;
+    job.count = count;
+    job.grain = tasks > 0 ? (count + tasks - 1) / tasks : 1;
+    tasks = tasks > 0 ? (count + job.grain - 1) / job.grain : 0;
+    job.partials = (int *)malloc(sizeof(int) * (tasks > 0 ? tasks : 1));
+    job.inline_run = parfor_inline || in_pool_task;
+    // 有步数上限（设置了 step_hook）时，循环体共用调用者剩余的步数
+    job.limited = step_hook != NULL;
+    // 调用者的预算减到 0 时才触发钩子，即还能执行 step_budget - 1 步
+    job.budget = step_budget - 1;
+    job.out_of_steps = 0;
+    job.failed = 0;
+    job.error_index = 0;
+    pthread_mutex_init(&job.error_lock, NULL);
+    if (job.partials == NULL) {
+        fatal_error("Error: Out of memory");
+    }
+    
+    pool_run((int)tasks, job.inline_run ? 1 : parfor_threads, parfor_task, &job);
+    pthread_mutex_destroy(&job.error_lock);
+    
+    // 剩余步数交还调用者；用完时在调用线程上按调用者的方式处理（报步数超限，或在工作线程上继续向外层领取）
+    if (job.limited && !job.inline_run) {
+        step_budget = job.budget > 0 ? job.budget + 1 : 1;
+        if (job.out_of_steps) {
+            free(job.partials);
+            step_budget = 0;
+            step_exhausted();
+            fatal_error("Error: parfor step budget exhausted");
         }
     }
+    if (job.failed) {
+        char message[ERROR_MESSAGE_SIZE];
+        memcpy(message, job.error, sizeof(message));
+        free(job.partials);
+        fatal_error("%s", message);
+    }
     
-    printf("Error: Function not defined: %s", name);
-    exit(1);
+    // 按块顺序归约到外层变量；循环变量与 for 一样停在第一个不满足条件的值
+    if (node->value != REDUCE_NONE) {
+        int result = find_variable(scope, node->name);
+        for (long long i = 0; i < tasks; i++) {
+            result = reduce_combine(node->value, result, job.partials[i]);
+        }
+        set_variable(scope, node->name, result);
+    }
+    set_variable(scope, init->name, (int)(start + count * step));
+    free(job.partials);
 }
 
-// 计算表达式
-int evaluate(Node *node, Scope *scope) {
-    if (node == NULL) {
-        return 0;
-    }
-    
-    switch (node->type) {
-        case NODE_NUMBER:
-            return node->value;
-        case NODE_IDENTIFIER:
-            return find_variable(scope, node->name);
-        case NODE_BINARY_OP:
-            {
-                int left = evaluate(node->left, scope);
-                int right = evaluate(node->right, scope);
+// 解释语句
+// 按 next 链依次执行，不在语句之间递归，长语句列表不会耗尽栈
+void interpret(Node *node, Scope *scope) {
+    while (node != NULL) {
+        COUNT_STEP();
+        TRACE(TRACE_STATEMENT, node->line, node->type);
+        switch (node->type) {
+            case NODE_PROGRAM:
+                interpret(node->body, scope);
+                break;
+            case NODE_VAR_DECL:
+                if (node->right) {
+                    set_variable(scope, node->name, evaluate(node->right, scope));
+                } else {
+                    set_variable(scope, node->name, 0);
+                }
+                break;
+            case NODE_ASSIGNMENT:
+                set_variable(scope, node->name, evaluate(node->right, scope));
+                break;
+            case NODE_ARRAY_DECL:
+                declare_array(scope, node->name, evaluate(node->left, scope));
+                break;
+            case NODE_INDEX_ASSIGN:
+                {
+                    // 先算下标和右值，再做边界检查并写入
+                    int index = evaluate(node->left, scope);
+                    int value = evaluate(node->right, scope);
+                    *array_element(scope, node->name, index) = value;
+                }
+                break;
+            case NODE_IF_STMT:
+                if (evaluate(node->left, scope)) {
+                    TRACE(TRACE_BRANCH, node->line, 1);
+                    interpret(node->body, scope);
+                } else {
+                    TRACE(TRACE_BRANCH, node->line, 0);
+                    if (node->else_body) {
+                        interpret(node->else_body, scope);
+                    }
+                }
+                break;
+            case NODE_FOR_STMT:
+                // 执行初始化语句
+                if (node->left) {
+                    interpret(node->left, scope);
+                }
                 
-                if (strcmp(node->name, "+") == 0) {
-                    return left + right;
-                } else if (strcmp(node->name, "-") == 0) {
-                    return left - right;
-                } else if (strcmp(node->name, "*") == 0) {
-                    return left * right;
-                } else if (strcmp(node->name, "/") == 0) {
-                    if (right == 0) {
-                        printf("Error: Division by zero");
-                        exit(1);
+                // 执行循环
+                while (evaluate(node->right, scope)) {
+                    interpret(node->else_body, scope);
+                    if (node->body) {
+                        interpret(node->body, scope);
                     }
-                    return left / right;
-                } else if (strcmp(node->name, "==") == 0) {
-                    return left == right;
-                } else if (strcmp(node->name, "!=") == 0) {
-                    return left != right;
-                } else if (strcmp(node->name, "<") == 0) {
-                    return left < right;
-                } else if (strcmp(node->name, ">") == 0) {
-                    return left > right;
-                } else if (strcmp(node->name, "<=") == 0) {
-                    return left <= right;
-                } else if (strcmp(node->name, ">=") == 0) {
-                    return left >= right;
+                    COUNT_STEP();
+                }
+                break;
+            case NODE_PARFOR_STMT:
+                execute_parfor(node, scope);
+                break;
+            case NODE_FUNCTION_CALL:
+                {
+                    Function *func = find_function(node->name);
+                    if (func->builtin != NULL) {
+                        func->builtin(node->args, scope);
+                        break;
+                    }
+                    if (func->native != NULL) {
+                        call_native(func, node->args, scope);
+                        break;
+                    }
+                    Scope local_scope = {{}, {}, 0, scope, {}};
+                    Frame frame = {&local_scope, NULL};
+                    enter_frame(&frame);
+                    
+                    // 绑定参数
+                    Node *param = func->params;
+                    Node *arg = node->args;
+                    while (param != NULL && arg != NULL) {
+                        set_variable(&local_scope, param->name, evaluate(arg, scope));
+                        param = param->next;
+                        arg = arg->next;
+                    }
+                    
+                    // 执行函数体（interpret 会依次执行整条语句链）
+                    TRACE(TRACE_ENTER, node->line, func - functions);
+                    interpret(func->body, &local_scope);
+                    // 返回表达式中可能有调用或 input()，照常求值，只丢弃结果
+                    evaluate(func->return_expr, &local_scope);
+                    leave_frame(&frame);
+                    TRACE(TRACE_EXIT, node->line, func - functions);
                 }
+                break;
+            case NODE_PRINT_STMT:
+                write_output("%d\n", evaluate(node->left, scope));
+                break;
+            case NODE_FUNCTION_DEF:
+                // 函数定义已经在解析时添加到函数列表
+                break;
+            case NODE_RETURN_STMT:
+                // 返回语句在函数调用时处理
+                break;
+            default:
+                break;
+        }
+        
+        // 解释下一条语句
+        node = node->next;
+    }
+}
+
+// 运行代码
+void run_code(const char *code) {
+    // 词法分析
+    tokenize(code);
+    
+    // 语法分析
+    Node *ast = parse_program();
+    
+    // 解释执行
+    interpret(ast, &global_scope);
+}
+
+// 读取整个文件，返回以 '\0' 结尾的缓冲区，失败返回 NULL
+char *read_file(const char *file_path, long *size) {
+    FILE *file = fopen(file_path, "rb");
+    if (file == NULL) {
+        printf("Error: Could not open file %s", file_path);
+        return NULL;
+    }
+    
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    char *code = (char *)malloc(file_size + 1);
+    if (code == NULL) {
+        printf("Error: Out of memory");
+        fclose(file);
+        return NULL;
+    }
+    file_size = (long)fread(code, 1, file_size, file);
+    code[file_size] = '\0';
+    
+    fclose(file);
+    if (size) {
+        *size = file_size;
+    }
+    return code;
+}
+
+// 运行文件
+void run_file(const char *file_path) {
+    long size = 0;
+    char *code = read_file(file_path, &size);
+    if (code == NULL) {
+        return;
+    }
+    if (frontend_jobs > 1) {
+        interpret(parse_program_parallel(code, size, NULL), &global_scope);
+    } else {
+        run_code(code);
+    }
+    free(code);
+}
+
+// 单调时钟，单位秒
+double now_seconds() {
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 进程峰值常驻内存，单位 KB
+long peak_rss_kb() {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// 内存统计快照；调用时不能有其他线程在分析或执行
+MemoryStats collect_memory_stats() {
+    report_node_count();
+    MemoryStats stats = memory_stats;
+    // 函数调用的作用域在 C 栈上，按峰值深度估算，另加全局作用域
+    stats.scope_bytes = (stats.peak_depth + 1) * (long long)sizeof(Scope);
+    stats.peak_rss_kb = peak_rss_kb();
+    return stats;
+}
+
+// 轨迹解码用的节点类型名，按 NodeType 的顺序（tools/trace_decode.py 中有同样的表）
+const char *node_type_names[] = {
+    "program", "declaration", "assignment", "if", "for", "parfor", "def", "call", "call",
+    "print", "input", "expression", "number", "identifier", "return", "array declaration",
+    "index", "index assignment"
+};
+#define NODE_TYPE_COUNT (int)(sizeof(node_type_names) / sizeof(node_type_names[0]))
+
+const char *trace_function_name(unsigned int index) {
+    return index < (unsigned int)function_count ? functions[index].name : "?";
+}
+
+// 把轨迹中最后 limit 个事件解码为文本，从早到晚排列；函数名按当前的函数表解析
+void format_trace(TextBuffer *out, const TraceRing *ring, int limit) {
+    unsigned long long count = ring->count;
+    unsigned long long first = count > TRACE_SIZE ? count - TRACE_SIZE : 0;
+    if (limit >= 0 && count - first > (unsigned long long)limit) {
+        first = count - limit;
+    }
+    buffer_printf(out, "Trace (last %llu of %llu events):\n", count - first, count);
+    for (unsigned long long i = first; i < count; i++) {
+        unsigned long long event = ring->events[i & (TRACE_SIZE - 1)];
+        int line = (int)((event >> 8) & 0xffffff);
+        unsigned int data = (unsigned int)(event >> 32);
+        switch ((TraceKind)(event & 0xff)) {
+            case TRACE_STATEMENT:
+                buffer_printf(out, "  line %d: %s\n", line, data < (unsigned int)NODE_TYPE_COUNT ? node_type_names[data] : "?");
+                break;
+            case TRACE_ENTER:
+                buffer_printf(out, "  line %d: enter %s\n", line, trace_function_name(data));
+                break;
+            case TRACE_EXIT:
+                buffer_printf(out, "  line %d: exit %s\n", line, trace_function_name(data));
+                break;
+            case TRACE_BRANCH:
+                buffer_printf(out, "  line %d: branch %s\n", line, data ? "then" : "else");
+                break;
+        }
+    }
+}
+
+// 出错退出前在 stderr 输出最近的轨迹
+void print_trace() {
+    if (trace_ring.count == 0 || trace_print_limit == 0) {
+        return;
+    }
+    TextBuffer text = {NULL, 0, 0};
+    format_trace(&text, &trace_ring, trace_print_limit);
+    fflush(stdout);
+    if (text.data != NULL) {
+        fprintf(stderr, "\n%s", text.data);
+    }
+    free(text.data);
+}
+
+#ifndef _WIN32
+void write_all(int fd, const void *data, size_t size) {
+    const char *p = (const char *)data;
+    while (size > 0) {
+        ssize_t written = write(fd, p, size);
+        if (written <= 0) {
+            return;
+        }
+        p += written;
+        size -= (size_t)written;
+    }
+}
+
+// 把主线程的轨迹按二进制格式写入 trace_dump_path，在信号处理函数中调用，只用异步信号安全的函数
+// 格式："CITRACE1"、事件总数 (u64)、缓冲区槽数 (u32)、函数数 (u32)、全部槽位 (u64 x 槽数)、
+// 以 '\0' 结尾的函数名；由 tools/trace_decode.py 解码
+void write_trace_dump() {
+    int fd = open(trace_dump_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    unsigned int sizes[2] = {TRACE_SIZE, (unsigned int)function_count};
+    write_all(fd, "CITRACE1", 8);
+    write_all(fd, &trace_signal_ring->count, sizeof(trace_signal_ring->count));
+    write_all(fd, sizes, sizeof(sizes));
+    write_all(fd, trace_signal_ring->events, sizeof(trace_signal_ring->events));
+    for (int i = 0; i < function_count; i++) {
+        write_all(fd, functions[i].name, strlen(functions[i].name) + 1);
+    }
+    close(fd);
+    const char message[] = "\nTrace written to ";
+    write_all(2, message, sizeof(message) - 1);
+    write_all(2, trace_dump_path, strlen(trace_dump_path));
+    write_all(2, "\n", 1);
+}
+
+// SIGUSR1 随时导出轨迹并继续运行；崩溃信号导出后按默认方式终止
+void trace_signal_handler(int sig) {
+    write_trace_dump();
+    if (sig != SIGUSR1) {
+        raise(sig);
+    }
+}
+
+// 栈溢出导致的 SIGSEGV 需要在备用栈上处理
+char trace_signal_stack[64 * 1024];
+
+void install_trace_signals() {
+    snprintf(trace_dump_path, sizeof(trace_dump_path), "c_interpreter.%ld.trace", (long)getpid());
+    trace_signal_ring = &trace_ring;
+    
+    stack_t alt;
+    alt.ss_sp = trace_signal_stack;
+    alt.ss_size = sizeof(trace_signal_stack);
+    alt.ss_flags = 0;
+    sigaltstack(&alt, NULL);
+    
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = trace_signal_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, NULL);
+    action.sa_flags = SA_ONSTACK | SA_RESETHAND;
+    sigaction(SIGSEGV, &action, NULL);
+    sigaction(SIGBUS, &action, NULL);
+    sigaction(SIGFPE, &action, NULL);
+    sigaction(SIGILL, &action, NULL);
+    sigaction(SIGABRT, &action, NULL);
+}
+#endif
+
+// --stats：退出时在 stderr 输出一行 key=value 统计
+void print_memory_stats() {
+    MemoryStats stats = collect_memory_stats();
+    fflush(stdout);
+    fprintf(stderr, "[stats] tokens=%lld nodes=%lld lexer_bytes=%lld parser_bytes=%lld function_bytes=%lld "
+            "scope_bytes=%lld array_bytes=%lld peak_array_bytes=%lld peak_depth=%lld peak_rss_kb=%lld\n",
+            stats.tokens, stats.nodes, stats.lexer_bytes, stats.parser_bytes, stats.function_bytes,
+            stats.scope_bytes, stats.array_bytes, stats.peak_array_bytes, stats.peak_depth, stats.peak_rss_kb);
+}
+
+// 前端基准：只做词法分析和语法分析，输出一行 key=value 统计，供 bench/bench_frontend.py 解析
+void bench_frontend(const char *file_path) {
+    long size = 0;
+    char *code = read_file(file_path, &size);
+    if (code == NULL) {
+        exit(1);
+    }
+    
+    FrontendStats stats = {0, 0, 0, 0, 0};
+    double t0 = now_seconds();
+    double t1 = t0;
+    if (frontend_jobs > 1) {
+        // 并行前端中词法和语法分析交错进行，只报告总耗时
+        parse_program_parallel(code, size, &stats);
+    } else {
+        tokenize(code);
+        t1 = now_seconds();
+        parse_program();
+        stats.tokens = token_count;
+        stats.nodes = node_count;
+        stats.token_bytes = sizeof(Token) * (size_t)token_capacity;
+        stats.lexeme_bytes = lexeme_arena.total;
+        stats.node_bytes = node_arena.total;
+    }
+    double t2 = now_seconds();
+    
+    printf("bytes=%ld jobs=%d tokens=%ld nodes=%ld functions=%d "
+           "lex_ms=%.3f parse_ms=%.3f total_ms=%.3f "
+           "token_bytes=%zu lexeme_bytes=%zu node_bytes=%zu peak_rss_kb=%ld\n",
+           size, frontend_jobs, stats.tokens, stats.nodes, function_count,
+           (t1 - t0) * 1000, (t2 - t1) * 1000, (t2 - t0) * 1000,
+           stats.token_bytes, stats.lexeme_bytes, stats.node_bytes,
+           peak_rss_kb());
+    free(code);
+}
+
+// 扫描一行输入：更新花括号深度，记录最后一个有效字符（忽略注释和空白）
+// if_open 记录最后一个顶层语句是否是没有 else 的 if：顶层的 if 置位，else、def、for、parfor 和 ';' 清除，
+// 这时以 } 结束的输入下一行可能还有 else
+void scan_repl_line(const char *line, int *depth, char *last, int *if_open) {
+    for (int i = 0; line[i] != '\0'; i++) {
+        if (line[i] == '/' && line[i+1] == '/') {
+            break;
+        }
+        if (line[i] == '{') {
+            (*depth)++;
+        } else if (line[i] == '}') {
+            (*depth)--;
+        } else if (*depth == 0 && line[i] == ';') {
+            *if_open = 0;
+        } else if (*depth == 0 && (isalpha((unsigned char)line[i]) || line[i] == '_') &&
+                   (i == 0 || !(isalnum((unsigned char)line[i-1]) || line[i-1] == '_'))) {
+            int n = 1;
+            while (isalnum((unsigned char)line[i+n]) || line[i+n] == '_') {
+                n++;
             }
-        case NODE_FUNCTION_CALL_EXPR:
-            {
-                Function *func = find_function(node->name);
-                Scope local_scope = {{}, {}, 0, scope};
-                
-                // 绑定参数
-                Node *param = func->params;
-                Node *arg = node->args;
-                while (param != NULL && arg != NULL) {
-                    set_variable(&local_scope, param->name, evaluate(arg, scope));
-                    param = param->next;
-                    arg = arg->next;
+            if (n == 2 && strncmp(line + i, "if", 2) == 0) {
+                *if_open = 1;
+            } else if ((n == 4 && strncmp(line + i, "else", 4) == 0) || (n == 3 && strncmp(line + i, "def", 3) == 0) ||
+                       (n == 3 && strncmp(line + i, "for", 3) == 0) || (n == 6 && strncmp(line + i, "parfor", 6) == 0)) {
+                *if_open = 0;
+            }
+            i += n - 1;
+        }
+        if (!isspace((unsigned char)line[i])) {
+            *last = line[i];
+        }
+    }
+}
+
+// 一行输入是否以关键字 else 开头
+int repl_line_starts_else(const char *line) {
+    while (isspace((unsigned char)*line)) {
+        line++;
+    }
+    return strncmp(line, "else", 4) == 0 && !isalnum((unsigned char)line[4]) && line[4] != '_';
+}
+
+// 执行一段 REPL 输入；出错时回到提示符，已有状态保留
+void repl_execute(const char *code) {
+    int saved_depth = call_depth;
+    Frame *saved_mark = unwind_mark;
+    jmp_buf env;
+    error_jmp = &env;
+    unwind_mark = frame_top;
+    if (setjmp(env) == 0) {
+        tokenize(code);
+        Node *ast = parse_program();
+        if (tokens[current_token].type != END) {
+            fatal_error("Error: Unexpected token");
+        }
+        if (step_limit > 0) {
+            step_budget = step_limit + 1;
+        }
+        interpret(ast, &global_scope);
+    } else {
+        // 出错时跳过了函数返回处的计数，被跳过的栈帧中的数组已在跳转前释放
+        call_depth = saved_depth;
+        printf("\n");
+    }
+    error_jmp = NULL;
+    unwind_mark = saved_mark;
+    fflush(stdout);
+}
+
+// 交互式解释器
+// 全局作用域和函数表在多次输入之间保留；每段输入单独做词法、语法分析并执行，
+// 耗时只与本次输入有关。重新定义同名函数只替换该函数。
+void repl() {
+    int interactive = isatty(fileno(stdin));
+    char line[4096];
+    char *buffer = NULL;
+    size_t length = 0;
+    size_t capacity = 0;
+    int depth = 0;
+    char last = '\0';
+    int if_open = 0;
+    // 输入以 if 的代码块结束，先读下一行看是否以 else 开头再执行
+    int pending_else = 0;
+    
+    while (1) {
+        if (interactive) {
+            printf(length == 0 ? ">>> " : "... ");
+            fflush(stdout);
+        }
+        if (fgets(line, sizeof(line), stdin) == NULL) {
+            if (pending_else) {
+                repl_execute(buffer);
+            }
+            break;
+        }
+        size_t line_length = strlen(line);
+        
+        // 下一行不是 else：先执行等待中的输入，再把这一行当作新的输入处理
+        if (pending_else) {
+            pending_else = 0;
+            if (!repl_line_starts_else(line)) {
+                repl_execute(buffer);
+                length = 0;
+                depth = 0;
+                last = '\0';
+                if_open = 0;
+            }
+        }
+        
+        // 命令
+        if (length == 0 && line[0] == ':') {
+            if (strncmp(line, ":quit", 5) == 0) {
+                break;
+            } else if (strncmp(line, ":vars", 5) == 0) {
+                for (int i = 0; i < global_scope.count; i++) {
+                    if (global_scope.arrays[i] != NULL) {
+                        printf("%s[%d]\n", global_scope.variables[i], global_scope.arrays[i]->length);
+                    } else {
+                        printf("%s = %d\n", global_scope.variables[i], global_scope.values[i]);
+                    }
                 }
-                
-                // 执行函数体
-                Node *stmt = func->body;
-                while (stmt != NULL) {
-                    interpret(stmt, &local_scope);
-                    stmt = stmt->next;
+            } else if (strncmp(line, ":funcs", 6) == 0) {
+                for (int i = 0; i < function_count; i++) {
+                    if (functions[i].builtin == NULL && functions[i].native == NULL) {
+                        printf("%s\n", functions[i].name);
+                    }
                 }
-                
-                // 返回值
-                return evaluate(func->return_expr, &local_scope);
+            } else if (strncmp(line, ":trace", 6) == 0) {
+                TextBuffer text = {NULL, 0, 0};
+                format_trace(&text, &trace_ring, trace_print_limit);
+                if (text.data != NULL) {
+                    fputs(text.data, stdout);
+                }
+                free(text.data);
+            } else {
+                printf("Commands: :vars  :funcs  :trace  :quit\n");
             }
-        case NODE_INPUT_EXPR:
-            {
-                int value;
-                printf("Input: ");
-                scanf("%d", &value);
-                return value;
+            continue;
+        }
+        
+        // 追加到当前输入块
+        if (length + line_length + 1 > capacity) {
+            capacity = (length + line_length + 1) * 2;
+            buffer = (char *)realloc(buffer, capacity);
+            if (buffer == NULL) {
+                fatal_error("Error: Out of memory");
             }
-        default:
-            return 0;
+        }
+        memcpy(buffer + length, line, line_length + 1);
+        length += line_length;
+        
+        // 超长行分多次读入，读完整行后再判断
+        if (line_length > 0 && line[line_length - 1] != '\n' && !feof(stdin)) {
+            continue;
+        }
+        
+        // 空行：丢弃空白输入，或提交等待中的不完整输入
+        char line_last = '\0';
+        scan_repl_line(buffer + length - line_length, &depth, &line_last, &if_open);
+        if (line_last == '\0') {
+            if (last == '\0') {
+                length = 0;
+                depth = 0;
+                continue;
+            }
+            if (depth > 0) {
+                continue;
+            }
+        } else {
+            last = line_last;
+            if (depth > 0 || (last != ';' && last != '}')) {
+                continue;
+            }
+            if (last == '}' && if_open) {
+                pending_else = 1;
+                continue;
+            }
+        }
+        
+        repl_execute(buffer);
+        length = 0;
+        depth = 0;
+        last = '\0';
+        if_open = 0;
+    }
+    
+    free(buffer);
+}
+
+#ifdef __linux__
+// 阻塞直到被监视的文件被写入或替换，之后稍等片刻合并连续事件
+void wait_for_change(int fd, const char *name) {
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed = 0;
+    
+    while (!changed) {
+        ssize_t n = read(fd, events, sizeof(events));
+        if (n <= 0) {
+            return;
+        }
+        for (char *p = events; p < events + n; ) {
+            struct inotify_event *event = (struct inotify_event *)p;
+            if (event->len > 0 && strcmp(event->name, name) == 0) {
+                changed = 1;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    
+    struct pollfd pfd = {fd, POLLIN, 0};
+    while (poll(&pfd, 1, 50) > 0) {
+        if (read(fd, events, sizeof(events)) <= 0) {
+            break;
+        }
+    }
+}
+
+// 在上一版本的顶层单元中查找文本完全相同的单元
+Unit *find_unit(Unit *units, int *slots, int slot_count, const Unit *unit) {
+    if (slot_count == 0) {
+        return NULL;
+    }
+    unsigned int mask = slot_count - 1;
+    for (unsigned int i = unit->hash & mask; slots[i] != 0; i = (i + 1) & mask) {
+        Unit *old = &units[slots[i] - 1];
+        if (old->hash == unit->hash && old->length == unit->length &&
+            memcmp(old->text, unit->text, unit->length) == 0) {
+            return old;
+        }
+    }
+    return NULL;
+}
+
+// 语法树中是否有尚未解析的延迟函数体（其行号在标记中，无法随语法树移动）
+int has_lazy_body(Node *node) {
+    for (; node != NULL; node = node->next) {
+        if (node->lazy_tokens != NULL ||
+            has_lazy_body(node->left) || has_lazy_body(node->right) || has_lazy_body(node->body) ||
+            has_lazy_body(node->else_body) || has_lazy_body(node->params) || has_lazy_body(node->args) ||
+            has_lazy_body(node->return_expr)) {
+            return 1;
+        }
     }
+    return 0;
 }
 
-// 解释语句
-void interpret(Node *node, Scope *scope) {
-    if (node == NULL) {
-        return;
+// 把语法树中的行号整体移动 delta 行，复用的单元在文件中上下移动后错误和轨迹仍指向正确的行
+void shift_lines(Node *node, int delta) {
+    for (; node != NULL; node = node->next) {
+        node->line += delta;
+        shift_lines(node->left, delta);
+        shift_lines(node->right, delta);
+        shift_lines(node->body, delta);
+        shift_lines(node->else_body, delta);
+        shift_lines(node->params, delta);
+        shift_lines(node->args, delta);
+        shift_lines(node->return_expr, delta);
+    }
+}
+
+// 释放一个版本的顶层单元；每个单元有自己的 def 列表
+void free_units(Unit *units, int count) {
+    for (int i = 0; i < count; i++) {
+        free(units[i].defs);
+    }
+    free(units);
+}
+
+// 监视模式：文件变化后只重新分析文本有变化的顶层单元，复用其余单元的语法树，再重新运行程序
+void watch_file(const char *file_path) {
+    const char *slash = strrchr(file_path, '/');
+    const char *name = slash ? slash + 1 : file_path;
+    char dir[4096];
+    if (slash) {
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - file_path), file_path);
+    } else {
+        strcpy(dir, ".");
     }
     
-    switch (node->type) {
-        case NODE_PROGRAM:
-            interpret(node->body, scope);
-            break;
-        case NODE_VAR_DECL:
-            if (node->right) {
-                set_variable(scope, node->name, evaluate(node->right, scope));
-            } else {
-                set_variable(scope, node->name, 0);
+    // 监视所在目录，编辑器常用“写临时文件再改名”的方式保存
+    int fd = inotify_init();
+    if (fd < 0 || inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        fatal_error("Error: Could not watch %s", file_path);
+    }
+    
+    char *old_code = NULL;
+    Unit *old_units = NULL;
+    int old_count = 0;
+    int *slots = NULL;
+    int slot_count = 0;
+    jmp_buf env;
+    
+    while (1) {
+        long size = 0;
+        char *code = read_file(file_path, &size);
+        if (code == NULL) {
+            printf("\n");
+            wait_for_change(fd, name);
+            continue;
+        }
+        
+        double t0 = now_seconds();
+        Unit *units = NULL;
+        int count = scan_top_level(code, size, &units);
+        // setjmp 之后会修改，声明为 volatile，出错跳回后才能读到正确的值
+        volatile int parsed = 0;
+        volatile int ok = 1;
+        
+        // 复用未变化单元的语法树，只分析变化的单元
+        // 每个旧单元只复用一次：行号随单元移动，同一棵语法树不能同时位于两处
+        char *volatile claimed = old_count > 0 ? (char *)calloc(old_count, 1) : NULL;
+        if (old_count > 0 && claimed == NULL) {
+            fatal_error("Error: Out of memory");
+        }
+        error_jmp = &env;
+        if (setjmp(env) == 0) {
+            for (int i = 0; i < count; i++) {
+                Unit *old = find_unit(old_units, slots, slot_count, &units[i]);
+                if (old != NULL && (claimed[old - old_units] ||
+                                    (old->line != units[i].line && has_lazy_body(old->ast)))) {
+                    old = NULL;
+                }
+                if (old != NULL) {
+                    // 语法树的行号以 old->line 为准，移动后同步更新，解析失败保留旧版本时仍然一致
+                    claimed[old - old_units] = 1;
+                    if (old->line != units[i].line) {
+                        shift_lines(old->ast, units[i].line - old->line);
+                        old->line = units[i].line;
+                    }
+                    // 复制 def 列表，新旧版本各自释放（解析失败时仍要保留旧版本）
+                    units[i].ast = old->ast;
+                    units[i].def_count = old->def_count;
+                    if (old->def_count > 0) {
+                        units[i].defs = (Node **)malloc(sizeof(Node *) * old->def_count);
+                        if (units[i].defs == NULL) {
+                            fatal_error("Error: Out of memory");
+                        }
+                        memcpy(units[i].defs, old->defs, sizeof(Node *) * old->def_count);
+                    }
+                } else {
+                    parse_unit(&units[i]);
+                    parsed++;
+                }
             }
-            break;
-        case NODE_ASSIGNMENT:
-            set_variable(scope, node->name, evaluate(node->right, scope));
-            break;
-        case NODE_IF_STMT:
-            if (evaluate(node->left, scope)) {
-                interpret(node->body, scope);
-            } else if (node->else_body) {
-                interpret(node->else_body, scope);
+        } else {
+            printf("\n");
+            ok = 0;
+        }
+        free(claimed);
+        double t1 = now_seconds();
+        
+        // 重新运行：清空全局状态，按源码顺序登记函数，再依次执行各单元
+        if (ok) {
+            release_arrays(&global_scope);
+            global_scope.count = 0;
+            reset_functions();
+            register_builtins();
+            for (int i = 0; i < count; i++) {
+                for (int j = 0; j < units[i].def_count; j++) {
+                    add_function(units[i].defs[j]);
+                }
             }
-            break;
-        case NODE_FOR_STMT:
-            // 执行初始化语句
-            if (node->left) {
-                interpret(node->left, scope);
+            call_depth = 0;
+            // 每次运行从空的轨迹开始，出错时与命令行一样输出最近的轨迹
+            trace_ring.count = 0;
+            if (setjmp(env) == 0) {
+                if (step_limit > 0) {
+                    step_budget = step_limit + 1;
+                }
+                for (int i = 0; i < count; i++) {
+                    interpret(units[i].ast, &global_scope);
+                }
+            } else {
+                // 出错时跳过了函数返回处的计数，被跳过的栈帧中的数组已在跳转前释放
+                call_depth = 0;
+                print_trace();
+                printf("\n");
             }
+        }
+        error_jmp = NULL;
+        double t2 = now_seconds();
+        fflush(stdout);
+        fprintf(stderr, "[watch] %s: reparsed %d/%d units in %.2f ms, ran in %.2f ms\n",
+                file_path, parsed, count, (t1 - t0) * 1000, (t2 - t1) * 1000);
+        
+        // 解析失败时保留上一版本，下次仍可复用
+        if (ok) {
+            free(old_code);
+            free_units(old_units, old_count);
+            old_code = code;
+            old_units = units;
+            old_count = count;
             
-            // 执行循环
-            while (evaluate(node->right, scope)) {
-                interpret(node->else_body, scope);
-                if (node->body) {
-                    interpret(node->body, scope);
-                }
+            free(slots);
+            slot_count = 16;
+            while (slot_count < old_count * 2) {
+                slot_count *= 2;
             }
-            break;
-        case NODE_FUNCTION_CALL:
-            {
-                Function *func = find_function(node->name);
-                Scope local_scope = {{}, {}, 0, scope};
-                
-                // 绑定参数
-                Node *param = func->params;
-                Node *arg = node->args;
-                while (param != NULL && arg != NULL) {
-                    set_variable(&local_scope, param->name, evaluate(arg, scope));
-                    param = param->next;
-                    arg = arg->next;
-                }
-                
-                // 执行函数体
-                Node *stmt = func->body;
-                while (stmt != NULL) {
-                    interpret(stmt, &local_scope);
-                    stmt = stmt->next;
+            slots = (int *)calloc(slot_count, sizeof(int));
+            for (int i = 0; i < old_count; i++) {
+                unsigned int j = old_units[i].hash & (slot_count - 1);
+                while (slots[j] != 0) {
+                    j = (j + 1) & (slot_count - 1);
                 }
+                slots[j] = i + 1;
             }
-            break;
-        case NODE_PRINT_STMT:
-            printf("%d\n", evaluate(node->left, scope));
-            break;
-        case NODE_FUNCTION_DEF:
-            // 函数定义已经在解析时添加到函数列表
-            break;
-        case NODE_RETURN_STMT:
-            // 返回语句在函数调用时处理
-            break;
-        default:
-            break;
+        } else {
+            free(code);
+            free_units(units, count);
+        }
+        
+        wait_for_change(fd, name);
     }
+}
+#else
+void watch_file(const char *file_path) {
+    fatal_error("Error: --watch requires inotify (Linux), cannot watch %s", file_path);
+}
+#endif
+
+#ifdef CI_LIBRARY
+#include "c_interpreter.h"
+
+// 有 ucontext 的平台上提供协程调度器，每个脚本在自己的堆栈上运行
+#if defined(__linux__) || defined(__FreeBSD__)
+#include <ucontext.h>
+#include <sys/mman.h>
+#define HAVE_COROUTINES 1
+#endif
+
+// 嵌入接口的解释器实例：运行时把它的全局作用域和函数表换入全局变量，结束后换出
+struct ci_interpreter {
+    Scope scope;
+    Function *functions;
+    int function_count;
+    int function_capacity;
+    int *function_slots;
+    int function_slot_count;
+    TextBuffer output;
+    int *inputs;
+    int input_count;
+    int input_capacity;
+    int input_next;
+    ci_input_callback input_callback;
+    void *input_data;
+    long long step_limit;
+    long long steps;
+    TextBuffer trace;
+    // 实例自己的词素和语法树，函数定义在之后的运行中仍然有效，销毁实例时释放
+    Arena lexemes;
+    Arena nodes;
+    char error[ERROR_MESSAGE_SIZE];
+};
+
+pthread_mutex_t ci_lock = PTHREAD_MUTEX_INITIALIZER;
+int ci_initialized = 0;
+ci_interpreter *ci_current = NULL;
+// 当前运行中已经发放的步数预算
+long long ci_granted = 0;
+
+// 换入 interp 的状态，saved 保存调用前的全局状态
+void ci_enter(ci_interpreter *interp, ci_interpreter *saved) {
+    saved->scope = global_scope;
+    saved->functions = functions;
+    saved->function_count = function_count;
+    saved->function_capacity = function_capacity;
+    saved->function_slots = function_slots;
+    saved->function_slot_count = function_slot_count;
+    saved->lexemes = lexeme_arena;
+    saved->nodes = node_arena;
+    
+    global_scope = interp->scope;
+    functions = interp->functions;
+    function_count = interp->function_count;
+    function_capacity = interp->function_capacity;
+    function_slots = interp->function_slots;
+    function_slot_count = interp->function_slot_count;
+    lexeme_arena = interp->lexemes;
+    node_arena = interp->nodes;
+    ci_current = interp;
+}
+
+void ci_leave(ci_interpreter *interp, ci_interpreter *saved) {
+    interp->scope = global_scope;
+    interp->functions = functions;
+    interp->function_count = function_count;
+    interp->function_capacity = function_capacity;
+    interp->function_slots = function_slots;
+    interp->function_slot_count = function_slot_count;
+    interp->lexemes = lexeme_arena;
+    interp->nodes = node_arena;
     
-    // 解释下一条语句
-    if (node->next) {
-        interpret(node->next, scope);
+    global_scope = saved->scope;
+    functions = saved->functions;
+    function_count = saved->function_count;
+    function_capacity = saved->function_capacity;
+    function_slots = saved->function_slots;
+    function_slot_count = saved->function_slot_count;
+    lexeme_arena = saved->lexemes;
+    node_arena = saved->nodes;
+    ci_current = NULL;
+}
+
+// input()：先取预先放入的值，取完后调用回调
+int ci_read_input(int *value) {
+    ci_interpreter *interp = ci_current;
+    if (interp->input_next < interp->input_count) {
+        *value = interp->inputs[interp->input_next++];
+        return 1;
     }
+    if (interp->input_callback != NULL) {
+        return interp->input_callback(interp->input_data, value) != 0;
+    }
+    return 0;
 }
 
-// 运行代码
-void run_code(const char *code) {
-    // 词法分析
-    tokenize(code);
+CI_API ci_interpreter *ci_create(void) {
+    ci_interpreter *interp = (ci_interpreter *)calloc(1, sizeof(ci_interpreter));
+    if (interp == NULL) {
+        return NULL;
+    }
+    interp->lexemes.allocated = &memory_stats.lexer_bytes;
+    interp->nodes.allocated = &memory_stats.parser_bytes;
     
-    // 语法分析
-    Node *ast = parse_program();
+    // 内置函数登记在实例自己的函数表中
+    ci_interpreter saved;
+    jmp_buf env;
+    pthread_mutex_lock(&ci_lock);
+    if (!ci_initialized) {
+        select_array_kernels();
+        parfor_threads = cpu_count();
+        ci_initialized = 1;
+    }
+    ci_enter(interp, &saved);
+    error_jmp = &env;
+    error_message = interp->error;
+    int ok = setjmp(env) == 0;
+    if (ok) {
+        register_builtins();
+    }
+    error_jmp = NULL;
+    error_message = NULL;
+    ci_leave(interp, &saved);
+    pthread_mutex_unlock(&ci_lock);
     
-    // 解释执行
+    if (!ok) {
+        ci_destroy(interp);
+        return NULL;
+    }
+    return interp;
+}
+
+CI_API void ci_destroy(ci_interpreter *interp) {
+    if (interp == NULL) {
+        return;
+    }
+    release_arrays(&interp->scope);
+    free(interp->functions);
+    free(interp->function_slots);
+    free(interp->output.data);
+    free(interp->trace.data);
+    free(interp->inputs);
+    arena_free(&interp->lexemes);
+    arena_free(&interp->nodes);
+    free(interp);
+}
+
+// 下一段步数预算：不超过 slice（0 表示不限），也不超过步数上限之后的第一步
+long long ci_grant(ci_interpreter *interp, long long slice) {
+    long long grant = slice > 0 ? slice : LLONG_MAX;
+    if (interp->step_limit > 0 && interp->step_limit + 1 - interp->steps < grant) {
+        grant = interp->step_limit + 1 - interp->steps;
+    }
+    return grant;
+}
+
+// 结算已用掉的预算，超过上限时报错
+void ci_charge_steps(ci_interpreter *interp) {
+    interp->steps += ci_granted - step_budget;
+    ci_granted = 0;
+    step_budget = 0;
+    if (interp->step_limit > 0 && interp->steps > interp->step_limit) {
+        fatal_error("Error: Step limit exceeded (%lld steps)", interp->step_limit);
+    }
+}
+
+// ci_run 中预算用完时只可能是到达了步数上限
+void ci_run_step_hook() {
+    ci_charge_steps(ci_current);
+    ci_granted = ci_grant(ci_current, 0);
+    step_budget = ci_granted;
+}
+
+// 解析并执行一段程序，出错时跳到调用者设置的 error_jmp
+void ci_execute(const char *code) {
+    tokenize(code);
+    Node *ast = parse_program();
+    if (tokens[current_token].type != END) {
+        fatal_error("Error: Unexpected token");
+    }
     interpret(ast, &global_scope);
 }
 
-// 运行文件
-void run_file(const char *file_path) {
-    FILE *file = fopen(file_path, "r");
-    if (file == NULL) {
-        printf("Error: Could not open file %s", file_path);
+// 一次运行开始前后的清理：清空输出和错误，丢弃已经用掉的输入
+void ci_begin_run(ci_interpreter *interp) {
+    ci_clear_output(interp);
+    interp->error[0] = '\0';
+    interp->steps = 0;
+    interp->trace.length = 0;
+    if (interp->trace.data != NULL) {
+        interp->trace.data[0] = '\0';
+    }
+}
+
+// 运行出错时保存 ring 中最近的轨迹，函数名按出错时的函数表解析
+void ci_save_trace(ci_interpreter *interp, const TraceRing *ring) {
+    interp->trace.length = 0;
+    format_trace(&interp->trace, ring, trace_print_limit);
+}
+
+// 语法树只引用词素，标记数组在分析结束后就不再需要，每次运行后释放
+void ci_end_run(ci_interpreter *interp) {
+    if (interp->input_next == interp->input_count) {
+        interp->input_count = 0;
+        interp->input_next = 0;
+    }
+    release_tokens();
+}
+
+// 运行一段程序；词素和语法树留在实例的内存区中，之后的运行仍可调用这里定义的函数
+CI_API int ci_run(ci_interpreter *interp, const char *code) {
+    ci_interpreter saved;
+    jmp_buf env;
+    int result = 0;
+    char *saved_stack_limit = stack_limit;
+    int saved_depth = call_depth;
+    Frame *saved_mark = unwind_mark;
+    
+    pthread_mutex_lock(&ci_lock);
+    ci_begin_run(interp);
+    ci_enter(interp, &saved);
+    error_jmp = &env;
+    error_message = interp->error;
+    output_buffer = &interp->output;
+    input_hook = ci_read_input;
+    ci_granted = ci_grant(interp, 0);
+    step_budget = ci_granted;
+    step_hook = ci_run_step_hook;
+    call_depth = 0;
+    unwind_mark = frame_top;
+    set_stack_limit(0);
+    // 每次运行从空的轨迹开始，不混入其他实例的事件
+    trace_ring.count = 0;
+    if (setjmp(env) == 0) {
+        ci_execute(code);
+    } else {
+        // 被跳过的栈帧中的数组已在跳转前释放
+        ci_save_trace(interp, &trace_ring);
+        result = -1;
+    }
+    interp->steps += ci_granted - step_budget;
+    step_budget = LLONG_MAX;
+    step_hook = NULL;
+    error_jmp = NULL;
+    error_message = NULL;
+    output_buffer = NULL;
+    input_hook = NULL;
+    stack_limit = saved_stack_limit;
+    call_depth = saved_depth;
+    unwind_mark = saved_mark;
+    ci_leave(interp, &saved);
+    ci_end_run(interp);
+    pthread_mutex_unlock(&ci_lock);
+    return result;
+}
+
+CI_API const char *ci_last_trace(const ci_interpreter *interp) {
+    return interp->trace.data != NULL ? interp->trace.data : "";
+}
+
+CI_API void ci_get_memory_stats(ci_memory_stats *stats) {
+    pthread_mutex_lock(&ci_lock);
+    MemoryStats snapshot = collect_memory_stats();
+    pthread_mutex_unlock(&ci_lock);
+    stats->tokens = snapshot.tokens;
+    stats->nodes = snapshot.nodes;
+    stats->lexer_bytes = snapshot.lexer_bytes;
+    stats->parser_bytes = snapshot.parser_bytes;
+    stats->function_bytes = snapshot.function_bytes;
+    stats->scope_bytes = snapshot.scope_bytes;
+    stats->array_bytes = snapshot.array_bytes;
+    stats->peak_array_bytes = snapshot.peak_array_bytes;
+    stats->peak_depth = snapshot.peak_depth;
+    stats->peak_rss_kb = snapshot.peak_rss_kb;
+}
+
+CI_API void ci_set_step_limit(ci_interpreter *interp, long long limit) {
+    interp->step_limit = limit > 0 ? limit : 0;
+}
+
+CI_API long long ci_steps(const ci_interpreter *interp) {
+    return interp->steps;
+}
+
+CI_API const char *ci_output(const ci_interpreter *interp) {
+    return interp->output.data != NULL ? interp->output.data : "";
+}
+
+CI_API size_t ci_output_length(const ci_interpreter *interp) {
+    return interp->output.length;
+}
+
+CI_API void ci_clear_output(ci_interpreter *interp) {
+    interp->output.length = 0;
+    if (interp->output.data != NULL) {
+        interp->output.data[0] = '\0';
+    }
+}
+
+CI_API const char *ci_last_error(const ci_interpreter *interp) {
+    return interp->error;
+}
+
+CI_API void ci_push_input(ci_interpreter *interp, int value) {
+    if (interp->input_count >= interp->input_capacity) {
+        int capacity = interp->input_capacity ? interp->input_capacity * 2 : 16;
+        int *inputs = (int *)realloc(interp->inputs, sizeof(int) * capacity);
+        if (inputs == NULL) {
+            return;
+        }
+        interp->inputs = inputs;
+        interp->input_capacity = capacity;
+    }
+    interp->inputs[interp->input_count++] = value;
+}
+
+CI_API void ci_set_input_callback(ci_interpreter *interp, ci_input_callback callback, void *user_data) {
+    interp->input_callback = callback;
+    interp->input_data = user_data;
+}
+
+// 登记原生函数；名字复制到词素内存区，与语法树中的名字一样一直有效
+CI_API int ci_register_function(ci_interpreter *interp, const char *name, ci_native_function function) {
+    ci_interpreter saved;
+    jmp_buf env;
+    int result = 0;
+    
+    pthread_mutex_lock(&ci_lock);
+    ci_enter(interp, &saved);
+    error_jmp = &env;
+    error_message = interp->error;
+    if (setjmp(env) == 0) {
+        add_native(save_lexeme(name, (int)strlen(name)), function);
+    } else {
+        result = -1;
+    }
+    error_jmp = NULL;
+    error_message = NULL;
+    ci_leave(interp, &saved);
+    pthread_mutex_unlock(&ci_lock);
+    return result;
+}
+
+CI_API int ci_global_count(const ci_interpreter *interp) {
+    return interp->scope.count;
+}
+
+CI_API const char *ci_global_name(const ci_interpreter *interp, int index) {
+    if (index < 0 || index >= interp->scope.count) {
+        return NULL;
+    }
+    return interp->scope.variables[index];
+}
+
+CI_API int ci_get_global(const ci_interpreter *interp, const char *name, int *value) {
+    for (int i = 0; i < interp->scope.count; i++) {
+        if (strcmp(interp->scope.variables[i], name) == 0) {
+            if (interp->scope.arrays[i] != NULL) {
+                return 0;
+            }
+            *value = interp->scope.values[i];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#ifdef HAVE_COROUTINES
+// 调度器中的一个脚本：在自己的协程栈上运行，挂起时保存线程局部的执行状态
+typedef struct {
+    ci_interpreter *interp;
+    char *code;
+    int status;
+    ucontext_t context;
+    char *stack;
+    size_t stack_size;
+    double spawn_time;
+    double finish_time;
+    struct ci_scheduler *scheduler;
+    jmp_buf *error_jmp;
+    char *error_message;
+    char *stack_limit;
+    int call_depth;
+    Frame *frame_top;
+    Frame *unwind_mark;
+    // 任务自己的轨迹：同一线程上的任务共用 trace_ring，每个时间片结束时把本片的事件移到这里
+    TraceRing *trace;
+    unsigned long long trace_mark;
+} ci_task;
+
+// 轮转调度器：就绪队列是任务下标的环形缓冲区
+struct ci_scheduler {
+    ucontext_t context;
+    ci_task **tasks;
+    int task_count;
+    int task_capacity;
+    int *queue;
+    int queue_head;
+    int queue_length;
+    long long slice_steps;
+    size_t stack_size;
+};
+
+ci_task *ci_running_task = NULL;
+
+// 协程栈底部留一页不可访问的保护页，栈溢出检查再留出 32 KB 余量给报错路径
+#define CI_STACK_GUARD 4096
+#define CI_STACK_MARGIN (32 * 1024)
+#define CI_DEFAULT_STACK_SIZE (1024 * 1024)
+#define CI_DEFAULT_SLICE_STEPS 1000
+
+// 把本时间片写入线程轨迹的事件追加到任务自己的轨迹中
+void ci_task_collect_trace(ci_task *task) {
+    unsigned long long end = trace_ring.count;
+    unsigned long long begin = end - task->trace_mark > TRACE_SIZE ? end - TRACE_SIZE : task->trace_mark;
+    for (unsigned long long i = begin; i < end; i++) {
+        task->trace->events[task->trace->count++ & (TRACE_SIZE - 1)] = trace_ring.events[i & (TRACE_SIZE - 1)];
+    }
+    task->trace_mark = end;
+}
+
+// 时间片用完：结算步数后切回调度器，恢复后继续领取下一片预算
+void ci_task_step_hook() {
+    ci_task *task = ci_running_task;
+    ci_charge_steps(task->interp);
+    ci_task_collect_trace(task);
+    
+    task->error_jmp = error_jmp;
+    task->error_message = error_message;
+    task->stack_limit = stack_limit;
+    task->call_depth = call_depth;
+    task->frame_top = frame_top;
+    task->unwind_mark = unwind_mark;
+    swapcontext(&task->context, &task->scheduler->context);
+    task->trace_mark = trace_ring.count;
+    error_jmp = task->error_jmp;
+    error_message = task->error_message;
+    stack_limit = task->stack_limit;
+    call_depth = task->call_depth;
+    frame_top = task->frame_top;
+    unwind_mark = task->unwind_mark;
+    output_buffer = &task->interp->output;
+    input_hook = ci_read_input;
+    step_hook = ci_task_step_hook;
+    
+    ci_granted = ci_grant(task->interp, task->scheduler->slice_steps);
+    step_budget = ci_granted;
+}
+
+// 协程入口：运行整段脚本，返回后经 uc_link 回到调度器
+void ci_task_main() {
+    ci_task *task = ci_running_task;
+    ci_interpreter *interp = task->interp;
+    jmp_buf env;
+    
+    error_jmp = &env;
+    error_message = interp->error;
+    output_buffer = &interp->output;
+    input_hook = ci_read_input;
+    stack_limit = task->stack + CI_STACK_GUARD + CI_STACK_MARGIN;
+    call_depth = 0;
+    frame_top = NULL;
+    unwind_mark = NULL;
+    step_hook = ci_task_step_hook;
+    ci_granted = ci_grant(interp, task->scheduler->slice_steps);
+    step_budget = ci_granted;
+    task->trace_mark = trace_ring.count;
+    if (setjmp(env) == 0) {
+        ci_execute(task->code);
+        task->status = CI_TASK_DONE;
+    } else {
+        ci_task_collect_trace(task);
+        ci_save_trace(interp, task->trace);
+        task->status = CI_TASK_FAILED;
+    }
+    interp->steps += ci_granted - step_budget;
+    ci_granted = 0;
+}
+
+CI_API ci_scheduler *ci_scheduler_create(long long slice_steps, size_t stack_size) {
+    ci_scheduler *scheduler = (ci_scheduler *)calloc(1, sizeof(ci_scheduler));
+    if (scheduler == NULL) {
+        return NULL;
+    }
+    scheduler->slice_steps = slice_steps;
+    scheduler->stack_size = stack_size > 0 ? stack_size : CI_DEFAULT_STACK_SIZE;
+    if (scheduler->stack_size < CI_STACK_GUARD + 2 * CI_STACK_MARGIN) {
+        scheduler->stack_size = CI_STACK_GUARD + 2 * CI_STACK_MARGIN;
+    }
+    return scheduler;
+}
+
+// 任务结束后释放协程栈和轨迹
+void ci_task_free_stack(ci_task *task) {
+    if (task->stack != NULL) {
+        munmap(task->stack, task->stack_size);
+        task->stack = NULL;
+    }
+    free(task->trace);
+    task->trace = NULL;
+}
+
+CI_API void ci_scheduler_destroy(ci_scheduler *scheduler) {
+    if (scheduler == NULL) {
         return;
     }
+    for (int i = 0; i < scheduler->task_count; i++) {
+        ci_task_free_stack(scheduler->tasks[i]);
+        free(scheduler->tasks[i]->code);
+        free(scheduler->tasks[i]);
+    }
+    free(scheduler->tasks);
+    free(scheduler->queue);
+    free(scheduler);
+}
+
+// 添加脚本，返回任务编号；interp 在任务结束前不能用于其他运行
+CI_API int ci_scheduler_spawn(ci_scheduler *scheduler, ci_interpreter *interp, const char *code) {
+    if (scheduler->task_count >= scheduler->task_capacity) {
+        int capacity = scheduler->task_capacity ? scheduler->task_capacity * 2 : 64;
+        ci_task **tasks = (ci_task **)realloc(scheduler->tasks, sizeof(ci_task *) * capacity);
+        if (tasks == NULL) {
+            return -1;
+        }
+        scheduler->tasks = tasks;
+        int *queue = (int *)malloc(sizeof(int) * capacity);
+        if (queue == NULL) {
+            return -1;
+        }
+        for (int i = 0; i < scheduler->queue_length; i++) {
+            queue[i] = scheduler->queue[(scheduler->queue_head + i) % scheduler->task_capacity];
+        }
+        free(scheduler->queue);
+        scheduler->queue = queue;
+        scheduler->queue_head = 0;
+        scheduler->task_capacity = capacity;
+    }
     
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    // ucontext_t 内含指向自身的指针，任务单独分配，地址不随数组扩容变化
+    ci_task *task = (ci_task *)calloc(1, sizeof(ci_task));
+    if (task == NULL) {
+        return -1;
+    }
+    task->code = (char *)malloc(strlen(code) + 1);
+    if (task->code == NULL) {
+        free(task);
+        return -1;
+    }
+    strcpy(task->code, code);
+    task->interp = interp;
+    task->scheduler = scheduler;
+    task->status = CI_TASK_READY;
+    task->spawn_time = now_seconds();
     
-    char *code = (char *)malloc(file_size + 1);
-    fread(code, 1, file_size, file);
-    code[file_size] = '\0';
+    int id = scheduler->task_count++;
+    scheduler->tasks[id] = task;
+    scheduler->queue[(scheduler->queue_head + scheduler->queue_length) % scheduler->task_capacity] = id;
+    scheduler->queue_length++;
+    return id;
+}
+
+// 为任务分配协程栈并设置入口
+int ci_task_start(ci_task *task) {
+    size_t size = task->scheduler->stack_size;
+    char *stack = (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (stack == MAP_FAILED) {
+        return 0;
+    }
+    mprotect(stack, CI_STACK_GUARD, PROT_NONE);
+    task->trace = (TraceRing *)malloc(sizeof(TraceRing));
+    if (task->trace == NULL) {
+        munmap(stack, size);
+        return 0;
+    }
+    task->trace->count = 0;
+    task->stack = stack;
+    task->stack_size = size;
+    getcontext(&task->context);
+    task->context.uc_stack.ss_sp = stack;
+    task->context.uc_stack.ss_size = size;
+    task->context.uc_link = &task->scheduler->context;
+    makecontext(&task->context, ci_task_main, 0);
+    return 1;
+}
+
+// 运行队首任务的一个时间片，返回尚未结束的任务数
+CI_API int ci_scheduler_step(ci_scheduler *scheduler) {
+    if (scheduler->queue_length == 0) {
+        return 0;
+    }
+    int id = scheduler->queue[scheduler->queue_head];
+    scheduler->queue_head = (scheduler->queue_head + 1) % scheduler->task_capacity;
+    scheduler->queue_length--;
+    ci_task *task = scheduler->tasks[id];
+    ci_interpreter *interp = task->interp;
+    ci_interpreter saved;
     
-    fclose(file);
-    run_code(code);
-    free(code);
+    pthread_mutex_lock(&ci_lock);
+    if (task->status == CI_TASK_READY) {
+        ci_begin_run(interp);
+        if (!ci_task_start(task)) {
+            snprintf(interp->error, ERROR_MESSAGE_SIZE, "Error: Out of memory");
+            task->status = CI_TASK_FAILED;
+        } else {
+            task->status = CI_TASK_RUNNING;
+        }
+    }
+    if (task->status == CI_TASK_RUNNING) {
+        ci_enter(interp, &saved);
+        ci_running_task = task;
+        // parfor 在协程上串行执行并照常计步，时间片用完时可以在循环体中让出
+        parfor_inline = 1;
+        swapcontext(&scheduler->context, &task->context);
+        parfor_inline = 0;
+        ci_running_task = NULL;
+        error_jmp = NULL;
+        error_message = NULL;
+        output_buffer = NULL;
+        input_hook = NULL;
+        stack_limit = NULL;
+        call_depth = 0;
+        frame_top = NULL;
+        unwind_mark = NULL;
+        step_budget = LLONG_MAX;
+        step_hook = NULL;
+        ci_leave(interp, &saved);
+    }
+    if (task->status == CI_TASK_RUNNING) {
+        scheduler->queue[(scheduler->queue_head + scheduler->queue_length) % scheduler->task_capacity] = id;
+        scheduler->queue_length++;
+    } else {
+        ci_task_free_stack(task);
+        ci_end_run(interp);
+        task->finish_time = now_seconds();
+    }
+    pthread_mutex_unlock(&ci_lock);
+    return scheduler->queue_length;
+}
+
+CI_API void ci_scheduler_run(ci_scheduler *scheduler) {
+    while (ci_scheduler_step(scheduler) > 0) {
+    }
+}
+
+CI_API int ci_task_status(const ci_scheduler *scheduler, int task) {
+    if (task < 0 || task >= scheduler->task_count) {
+        return -1;
+    }
+    return scheduler->tasks[task]->status;
+}
+
+CI_API double ci_task_latency(const ci_scheduler *scheduler, int task) {
+    if (task < 0 || task >= scheduler->task_count || scheduler->tasks[task]->finish_time == 0) {
+        return -1;
+    }
+    return scheduler->tasks[task]->finish_time - scheduler->tasks[task]->spawn_time;
+}
+#else
+CI_API ci_scheduler *ci_scheduler_create(long long slice_steps, size_t stack_size) {
+    (void)slice_steps;
+    (void)stack_size;
+    return NULL;
+}
+
+CI_API void ci_scheduler_destroy(ci_scheduler *scheduler) {
+    (void)scheduler;
+}
+
+CI_API int ci_scheduler_spawn(ci_scheduler *scheduler, ci_interpreter *interp, const char *code) {
+    (void)scheduler;
+    (void)interp;
+    (void)code;
+    return -1;
+}
+
+CI_API int ci_scheduler_step(ci_scheduler *scheduler) {
+    (void)scheduler;
+    return 0;
 }
 
+CI_API void ci_scheduler_run(ci_scheduler *scheduler) {
+    (void)scheduler;
+}
+
+CI_API int ci_task_status(const ci_scheduler *scheduler, int task) {
+    (void)scheduler;
+    (void)task;
+    return -1;
+}
+
+CI_API double ci_task_latency(const ci_scheduler *scheduler, int task) {
+    (void)scheduler;
+    (void)task;
+    return -1;
+}
+#endif
+
+#else
 int main(int argc, char *argv[]) {
-    if (argc > 1) {
+    // 通用选项
+    int arg = 1;
+    while (arg < argc && strncmp(argv[arg], "--", 2) == 0) {
+        if (strcmp(argv[arg], "--lazy") == 0) {
+            // 预解析模式：函数体在首次调用时才解析
+            lazy_parse = 1;
+        } else if (strcmp(argv[arg], "--jobs") == 0 && arg + 1 < argc) {
+            // 并行前端的线程数，0 表示使用全部 CPU 核
+            frontend_jobs = atoi(argv[++arg]);
+            if (frontend_jobs <= 0) {
+                frontend_jobs = cpu_count();
+            }
+        } else if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc) {
+            // parfor 使用的线程数，默认使用全部 CPU 核
+            parfor_threads = atoi(argv[++arg]);
+        } else if (strcmp(argv[arg], "--trace") == 0 && arg + 1 < argc) {
+            // 出错时输出的轨迹事件数，0 表示不输出，负数表示输出整个缓冲区
+            trace_print_limit = atoi(argv[++arg]);
+        } else if (strcmp(argv[arg], "--stats") == 0) {
+            // 退出时输出内存统计（出错退出时也输出）
+            atexit(print_memory_stats);
+        } else if (strcmp(argv[arg], "--step-limit") == 0 && arg + 1 < argc) {
+            // 执行步数上限，用于终止失控的循环
+            step_limit = atoll(argv[++arg]);
+            if (step_limit > 0) {
+                step_budget = step_limit + 1;
+                step_hook = step_limit_exceeded;
+            }
+        } else {
+            break;
+        }
+        arg++;
+    }
+    
+    // 线程数在任何 parfor 运行之前确定，之后只读
+    if (parfor_threads <= 0) {
+        parfor_threads = cpu_count();
+    }
+    select_array_kernels();
+    set_stack_limit(1);
+#ifndef _WIN32
+    install_trace_signals();
+#endif
+    
+    if (argc - arg > 1 && strcmp(argv[arg], "--bench-frontend") == 0) {
+        // 只测量词法和语法分析
+        bench_frontend(argv[arg + 1]);
+    } else if (argc - arg > 1 && strcmp(argv[arg], "--watch") == 0) {
+        // 监视文件，变化后增量重新运行
+        watch_file(argv[arg + 1]);
+    } else if (argc > arg) {
         // 运行指定的.c文件
-        run_file(argv[1]);
+        register_builtins();
+        run_file(argv[arg]);
     } else {
-        // 测试代码
-        const char *test_code = "int a = 10;\n" 
-                               "int b = 5;\n" 
-                               "int c = a + b;\n" 
-                               "print(c);\n" 
-                               "def add(int x, int y) {\n" 
-                               "    int sum = x + y;\n" 
-                               "    return sum;\n" 
-                               "}\n" 
-                               "int result = add(a, b);\n" 
-                               "print(result);\n" 
-                               "for (int i = 0; i < 5; i = i + 1) {\n" 
-                               "    print(i);\n" 
-                               "}\n";
-        
-        run_code(test_code);
+        // 交互式解释器
+        register_builtins();
+        repl();
     }
     
     return 0;
 }
+#endif
@@ -0,0 +1,115 @@
+/*
+ * C 语言解释器嵌入接口
+ *
+ * 编译共享库：
+ *     gcc -O2 -shared -fPIC -fvisibility=hidden -pthread -DCI_LIBRARY -o libc_interpreter.so c_interpreter.c
+ *
+ * 每个 ci_interpreter 有自己的全局变量、函数表和语法树，多次 ci_run 之间保留，ci_destroy 时释放；
+ * print 的输出收集到缓冲区，input() 依次取 ci_push_input 放入的值，取完后调用输入回调。
+ * ci_run 在库内部串行执行，可以从多个线程调用，但不能在输入回调中再调用 ci_run。
+ */
+#ifndef C_INTERPRETER_H
+#define C_INTERPRETER_H
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#define CI_API __declspec(dllexport)
+#elif defined(__GNUC__)
+#define CI_API __attribute__((visibility("default")))
+#else
+#define CI_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ci_interpreter ci_interpreter;
+
+// 输入回调：把下一个输入值写入 *value 并返回 1，没有输入时返回 0
+typedef int (*ci_input_callback)(void *user_data, int *value);
+
+// 原生函数：args 按源码顺序存放 count 个参数；在 parfor 中可能被多个线程同时调用
+typedef int (*ci_native_function)(int *args, int count);
+
+CI_API ci_interpreter *ci_create(void);
+CI_API void ci_destroy(ci_interpreter *interp);
+
+// 运行一段程序，成功返回 0，出错返回 -1（错误信息见 ci_last_error）
+CI_API int ci_run(ci_interpreter *interp, const char *code);
+
+// 最近一次 ci_run 中 print 输出的文本，以 '\0' 结尾
+CI_API const char *ci_output(const ci_interpreter *interp);
+CI_API size_t ci_output_length(const ci_interpreter *interp);
+CI_API void ci_clear_output(ci_interpreter *interp);
+
+// 上次 ci_run 的错误信息，没有错误时为空串
+CI_API const char *ci_last_error(const ci_interpreter *interp);
+
+// 上次运行出错前最近的执行轨迹（语句、函数进入/返回和分支），已解码为文本，没有出错时为空串
+// 调度器中交错运行的任务共用一个轨迹缓冲区，其中可能混有其他任务的事件
+CI_API const char *ci_last_trace(const ci_interpreter *interp);
+
+CI_API void ci_push_input(ci_interpreter *interp, int value);
+CI_API void ci_set_input_callback(ci_interpreter *interp, ci_input_callback callback, void *user_data);
+
+// 登记脚本可调用的原生函数，调用时不创建作用域；与内置函数或 def 同名时替换它们
+// 成功返回 0，失败返回 -1
+CI_API int ci_register_function(ci_interpreter *interp, const char *name, ci_native_function function);
+
+// 内存统计，整个进程所有实例的合计
+// 词法、语法分析和函数表为累计分配的字节数（ci_destroy 释放后也不扣减），数组为当前占用和峰值，scope_bytes 按函数调用峰值深度估算
+typedef struct {
+    long long tokens;
+    long long nodes;
+    long long lexer_bytes;
+    long long parser_bytes;
+    long long function_bytes;
+    long long scope_bytes;
+    long long array_bytes;
+    long long peak_array_bytes;
+    long long peak_depth;
+    long long peak_rss_kb;
+} ci_memory_stats;
+
+CI_API void ci_get_memory_stats(ci_memory_stats *stats);
+
+// 每次运行的步数上限（语句、循环回边和函数调用各记一步），超过时以错误结束；0 表示不限
+CI_API void ci_set_step_limit(ci_interpreter *interp, long long limit);
+// 最近一次运行用掉的步数（包括 parfor 循环体内各线程的步数）
+CI_API long long ci_steps(const ci_interpreter *interp);
+
+// 协作式调度器：在一个线程上轮转运行多个脚本，每个脚本每次最多执行 slice_steps 步后挂起
+// 每个脚本有自己的协程栈（stack_size 字节，0 表示 1 MB），同一个 ci_interpreter 同时只能有一个任务
+// 调度期间输入回调会阻塞整个调度器；只在有 ucontext 的平台上可用，其他平台 ci_scheduler_create 返回 NULL
+typedef struct ci_scheduler ci_scheduler;
+
+enum {
+    CI_TASK_READY,
+    CI_TASK_RUNNING,
+    CI_TASK_DONE,
+    CI_TASK_FAILED
+};
+
+CI_API ci_scheduler *ci_scheduler_create(long long slice_steps, size_t stack_size);
+CI_API void ci_scheduler_destroy(ci_scheduler *scheduler);
+// 添加脚本，返回任务编号，失败返回 -1；结果从对应 ci_interpreter 的 ci_output / ci_last_error 读取
+CI_API int ci_scheduler_spawn(ci_scheduler *scheduler, ci_interpreter *interp, const char *code);
+// 运行队首任务的一个时间片，返回尚未结束的任务数
+CI_API int ci_scheduler_step(ci_scheduler *scheduler);
+CI_API void ci_scheduler_run(ci_scheduler *scheduler);
+CI_API int ci_task_status(const ci_scheduler *scheduler, int task);
+// 从添加到结束经过的秒数，任务未结束时返回 -1
+CI_API double ci_task_latency(const ci_scheduler *scheduler, int task);
+
+// 全局变量：按下标枚举名字，按名字读取整数值（数组返回 0 表示读取失败）
+CI_API int ci_global_count(const ci_interpreter *interp);
+CI_API const char *ci_global_name(const ci_interpreter *interp, int index);
+CI_API int ci_get_global(const ci_interpreter *interp, const char *name, int *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
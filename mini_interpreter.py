@@ -8,8 +8,15 @@
 3. 函数系统：函数定义、调用、作用域隔离
 4. 输入输出功能：input()和print()函数
 5. 扩展性架构：基于列表结构的语法规则定义
+6. 多个引擎：Interpreter 默认是把语法树编译成闭包的纯 Python 引擎；
+   MINI_INTERPRETER_ENGINE=c 时通过 ctypes 在 C 版本编译出的共享库上运行程序（C 语义，见 CInterpreter），
+   python 为逐节点解释的原始实现
 """
 
+import contextlib
+import ctypes
+import io
+import os
 import re
 import sys
 
@@ -371,13 +378,28 @@ class Parser:
                 raise SyntaxError(f"Expected {token_type}, got {self.tokens[self.pos][0]}")
         self.pos += 1
 
-# 解释器核心
-class Interpreter:
+# 解释器核心（纯 Python 实现）
+class PythonInterpreter:
+    engine = 'python'
+    
     def __init__(self):
         self.globals = {}
         self.functions = {}
+        self.inputs = []
+    
+    def run(self, code, inputs=None, capture=False):
+        """运行程序；inputs 中的值依次作为 input() 的结果，取完后从标准输入读取；
+        capture 为真时不输出，而是返回 print 输出的文本"""
+        if inputs is not None:
+            self.inputs = [int(value) for value in inputs]
+        if capture:
+            buffer = io.StringIO()
+            with contextlib.redirect_stdout(buffer):
+                self.execute(code)
+            return buffer.getvalue()
+        self.execute(code)
     
-    def run(self, code):
+    def execute(self, code):
         try:
             lexer = Lexer(code)
             tokens = lexer.tokenize()
@@ -387,6 +409,14 @@ class Interpreter:
         except Exception as e:
             print(f"Error: {e}")
     
+    def read_input(self):
+        if self.inputs:
+            return self.inputs.pop(0)
+        try:
+            return int(input())
+        except ValueError:
+            raise RuntimeError("Input must be an integer")
+    
     def interpret(self, node, scope):
         if node['type'] == 'program':
             for stmt in node['body']:
@@ -429,11 +459,7 @@ class Interpreter:
             value = self.evaluate(node['expr'], scope)
             print(value)
         elif node['type'] == 'input_stmt':
-            try:
-                value = int(input())
-                scope[node['name']] = value
-            except ValueError:
-                raise RuntimeError("Input must be an integer")
+            scope[node['name']] = self.read_input()
     
     def evaluate(self, node, scope):
         if node['type'] == 'number':
@@ -448,10 +474,7 @@ class Interpreter:
         elif node['type'] == 'function_call_expr':
             if node['name'] == 'input':
                 # 处理内置 input() 函数
-                try:
-                    return int(input())
-                except ValueError:
-                    raise RuntimeError("Input must be an integer")
+                return self.read_input()
             elif node['name'] not in self.functions:
                 raise NameError(f"Function not defined: {node['name']}")
             func = self.functions[node['name']]
@@ -491,6 +514,438 @@ class Interpreter:
         else:
             raise RuntimeError(f"Unknown expression type: {node['type']}")
 
+# 闭包编译引擎：把语法树一次性转换成嵌套的 Python 闭包再执行
+# 运算符在编译时选定，函数的局部变量编号后存放在列表里，调用时不再创建字典；
+# 函数中从未赋值的名字直接编译为全局变量读取
+UNSET = object()
+
+class ClosureInterpreter(PythonInterpreter):
+    engine = 'closure'
+    
+    def __init__(self):
+        super().__init__()
+        self.compiled = {}
+    
+    def execute(self, code):
+        try:
+            lexer = Lexer(code)
+            tokens = lexer.tokenize()
+            parser = Parser(tokens)
+            ast = parser.parse()
+            self.compile_block(ast['body'], None)(self.globals)
+        except Exception as e:
+            print(f"Error: {e}")
+    
+    # slots 为 None 表示顶层，此时帧就是全局字典；否则为函数局部变量名到下标的映射
+    def compile_block(self, stmts, slots):
+        compiled = [self.compile_stmt(stmt, slots) for stmt in stmts or ()]
+        if len(compiled) == 1:
+            return compiled[0]
+        def block(f):
+            for stmt in compiled:
+                stmt(f)
+        return block
+    
+    def compile_store(self, name, value, slots):
+        if slots is None:
+            def store(f):
+                f[name] = value(f)
+        else:
+            index = slots[name]
+            def store(f):
+                f[index] = value(f)
+        return store
+    
+    def compile_stmt(self, node, slots):
+        kind = node['type']
+        if kind == 'var_decl':
+            value = self.compile_expr(node['value'], slots) if node['value'] else (lambda f: 0)
+            return self.compile_store(node['name'], value, slots)
+        elif kind == 'assignment':
+            return self.compile_store(node['name'], self.compile_expr(node['value'], slots), slots)
+        elif kind == 'if_stmt':
+            condition = self.compile_expr(node['condition'], slots)
+            then_body = self.compile_block(node['then_body'], slots)
+            if node['else_body']:
+                else_body = self.compile_block(node['else_body'], slots)
+                def if_else(f):
+                    if condition(f):
+                        then_body(f)
+                    else:
+                        else_body(f)
+                return if_else
+            def if_then(f):
+                if condition(f):
+                    then_body(f)
+            return if_then
+        elif kind == 'for_stmt':
+            init = self.compile_stmt(node['init'], slots)
+            condition = self.compile_expr(node['condition'], slots)
+            body = self.compile_block(node['body'], slots)
+            increment = self.compile_stmt(node['increment'], slots)
+            def for_loop(f):
+                init(f)
+                while condition(f):
+                    body(f)
+                    increment(f)
+            return for_loop
+        elif kind == 'function_def':
+            entry = self.compile_function(node)
+            name = node['name']
+            functions = self.functions
+            compiled = self.compiled
+            def define(f):
+                functions[name] = node
+                compiled[name] = entry
+            return define
+        elif kind == 'function_call':
+            call = self.compile_call(node, slots)
+            def call_stmt(f):
+                call(f)
+            return call_stmt
+        elif kind == 'print_stmt':
+            expr = self.compile_expr(node['expr'], slots)
+            def print_stmt(f):
+                print(expr(f))
+            return print_stmt
+        elif kind == 'input_stmt':
+            read_input = self.read_input
+            return self.compile_store(node['name'], lambda f: read_input(), slots)
+        return lambda f: None
+    
+    # 函数编译为 (参数个数, 局部变量个数, 函数体, 返回值)；参数占用前几个槽位
+    def compile_function(self, node):
+        slots = {}
+        for param in node['params']:
+            slots.setdefault(param, len(slots))
+        self.collect_locals(node['body'], slots)
+        body = self.compile_block(node['body'], slots)
+        if node['return_expr'] is not None:
+            result = self.compile_expr(node['return_expr'], slots)
+        else:
+            name = node['name']
+            def result(f):
+                raise RuntimeError(f"Function {name} has no return value")
+        return (len(node['params']), len(slots), body, result)
+    
+    def collect_locals(self, stmts, slots):
+        for stmt in stmts or ():
+            kind = stmt['type']
+            if kind in ('var_decl', 'assignment', 'input_stmt'):
+                slots.setdefault(stmt['name'], len(slots))
+            elif kind == 'if_stmt':
+                self.collect_locals(stmt['then_body'], slots)
+                self.collect_locals(stmt['else_body'], slots)
+            elif kind == 'for_stmt':
+                self.collect_locals([stmt['init'], stmt['increment']], slots)
+                self.collect_locals(stmt['body'], slots)
+    
+    # 语句形式的调用也要求值返回表达式（其中可能有调用或 input()），由调用者丢弃结果
+    def compile_call(self, node, slots):
+        name = node['name']
+        args = [self.compile_expr(arg, slots) for arg in node['args']]
+        count = len(args)
+        compiled = self.compiled
+        def lookup():
+            entry = compiled.get(name)
+            if entry is None:
+                raise NameError(f"Function not defined: {name}")
+            if count != entry[0]:
+                raise TypeError(f"Expected {entry[0]} arguments, got {count}")
+            return entry
+        # 常见的参数个数单独展开，省去循环
+        if count == 1:
+            arg0 = args[0]
+            def call(f):
+                params, size, body, result = lookup()
+                frame = [UNSET] * size
+                frame[0] = arg0(f)
+                body(frame)
+                return result(frame)
+        elif count == 2:
+            arg0, arg1 = args
+            def call(f):
+                params, size, body, result = lookup()
+                frame = [UNSET] * size
+                frame[0] = arg0(f)
+                frame[1] = arg1(f)
+                body(frame)
+                return result(frame)
+        else:
+            def call(f):
+                params, size, body, result = lookup()
+                frame = [UNSET] * size
+                for i in range(count):
+                    frame[i] = args[i](f)
+                body(frame)
+                return result(frame)
+        return call
+    
+    def compile_expr(self, node, slots):
+        kind = node['type']
+        if kind == 'number':
+            value = node['value']
+            return lambda f: value
+        elif kind == 'identifier':
+            return self.compile_load(node['name'], slots)
+        elif kind == 'function_call_expr':
+            if node['name'] == 'input':
+                read_input = self.read_input
+                return lambda f: read_input()
+            return self.compile_call(node, slots)
+        elif kind == 'binary_op':
+            return self.compile_binary(node, slots)
+        def unknown(f):
+            raise RuntimeError(f"Unknown expression type: {kind}")
+        return unknown
+    
+    def compile_load(self, name, slots):
+        globals_ = self.globals
+        def load_global(f):
+            try:
+                return globals_[name]
+            except KeyError:
+                raise NameError(f"Variable not defined: {name}") from None
+        if slots is None or name not in slots:
+            return load_global
+        index = slots[name]
+        # 局部变量在赋值前回退到全局变量，与字典作用域的查找顺序一致
+        def load_local(f):
+            value = f[index]
+            if value is UNSET:
+                return load_global(f)
+            return value
+        return load_local
+    
+    def compile_binary(self, node, slots):
+        op = node['op']
+        left = self.compile_expr(node['left'], slots)
+        right_node = node['right']
+        if op == '/':
+            right = self.compile_expr(right_node, slots)
+            def divide(f):
+                a = left(f)
+                b = right(f)
+                if b == 0:
+                    raise ZeroDivisionError("Division by zero")
+                return a // b
+            return divide
+        # 右操作数是常数时（如 i + 1、i < n 中的常见形式）省去一次闭包调用
+        if right_node['type'] == 'number':
+            c = right_node['value']
+            factories = {
+                '+': lambda: lambda f: left(f) + c,
+                '-': lambda: lambda f: left(f) - c,
+                '*': lambda: lambda f: left(f) * c,
+                '==': lambda: lambda f: left(f) == c,
+                '!=': lambda: lambda f: left(f) != c,
+                '<': lambda: lambda f: left(f) < c,
+                '>': lambda: lambda f: left(f) > c,
+                '<=': lambda: lambda f: left(f) <= c,
+                '>=': lambda: lambda f: left(f) >= c,
+            }
+        else:
+            right = self.compile_expr(right_node, slots)
+            factories = {
+                '+': lambda: lambda f: left(f) + right(f),
+                '-': lambda: lambda f: left(f) - right(f),
+                '*': lambda: lambda f: left(f) * right(f),
+                '==': lambda: lambda f: left(f) == right(f),
+                '!=': lambda: lambda f: left(f) != right(f),
+                '<': lambda: lambda f: left(f) < right(f),
+                '>': lambda: lambda f: left(f) > right(f),
+                '<=': lambda: lambda f: left(f) <= right(f),
+                '>=': lambda: lambda f: left(f) >= right(f),
+            }
+        if op not in factories:
+            return lambda f: None
+        return factories[op]()
+
+# C 引擎绑定：加载 c_interpreter.h 描述的共享库
+#     gcc -O2 -shared -fPIC -fvisibility=hidden -pthread -DCI_LIBRARY -o libc_interpreter.so c_interpreter.c
+# 依次查找 MINI_INTERPRETER_LIB 指定的路径和本文件所在目录
+INPUT_CALLBACK = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p, ctypes.POINTER(ctypes.c_int))
+NATIVE_FUNCTION = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.POINTER(ctypes.c_int), ctypes.c_int)
+
+# 与 c_interpreter.h 中的 ci_memory_stats 对应
+class MemoryStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_longlong) for name in (
+        'tokens', 'nodes', 'lexer_bytes', 'parser_bytes', 'function_bytes', 'scope_bytes',
+        'array_bytes', 'peak_array_bytes', 'peak_depth', 'peak_rss_kb')]
+
+def load_c_engine():
+    directory = os.path.dirname(os.path.abspath(__file__))
+    candidates = [os.environ.get('MINI_INTERPRETER_LIB')]
+    candidates += [os.path.join(directory, name) for name in ('libc_interpreter.so', 'libc_interpreter.dylib', 'c_interpreter.dll')]
+    for path in candidates:
+        if not path or not os.path.exists(path):
+            continue
+        try:
+            lib = ctypes.CDLL(path)
+        except OSError:
+            continue
+        lib.ci_create.restype = ctypes.c_void_p
+        lib.ci_create.argtypes = []
+        lib.ci_destroy.restype = None
+        lib.ci_destroy.argtypes = [ctypes.c_void_p]
+        lib.ci_run.restype = ctypes.c_int
+        lib.ci_run.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        lib.ci_output.restype = ctypes.c_char_p
+        lib.ci_output.argtypes = [ctypes.c_void_p]
+        lib.ci_clear_output.restype = None
+        lib.ci_clear_output.argtypes = [ctypes.c_void_p]
+        lib.ci_last_error.restype = ctypes.c_char_p
+        lib.ci_last_error.argtypes = [ctypes.c_void_p]
+        lib.ci_last_trace.restype = ctypes.c_char_p
+        lib.ci_last_trace.argtypes = [ctypes.c_void_p]
+        lib.ci_push_input.restype = None
+        lib.ci_push_input.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        lib.ci_set_input_callback.restype = None
+        lib.ci_set_input_callback.argtypes = [ctypes.c_void_p, INPUT_CALLBACK, ctypes.c_void_p]
+        lib.ci_register_function.restype = ctypes.c_int
+        lib.ci_register_function.argtypes = [ctypes.c_void_p, ctypes.c_char_p, NATIVE_FUNCTION]
+        lib.ci_global_count.restype = ctypes.c_int
+        lib.ci_global_count.argtypes = [ctypes.c_void_p]
+        lib.ci_global_name.restype = ctypes.c_char_p
+        lib.ci_global_name.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        lib.ci_get_global.restype = ctypes.c_int
+        lib.ci_get_global.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_int)]
+        lib.ci_get_memory_stats.restype = None
+        lib.ci_get_memory_stats.argtypes = [ctypes.POINTER(MemoryStats)]
+        lib.ci_set_step_limit.restype = None
+        lib.ci_set_step_limit.argtypes = [ctypes.c_void_p, ctypes.c_longlong]
+        lib.ci_steps.restype = ctypes.c_longlong
+        lib.ci_steps.argtypes = [ctypes.c_void_p]
+        lib.ci_scheduler_create.restype = ctypes.c_void_p
+        lib.ci_scheduler_create.argtypes = [ctypes.c_longlong, ctypes.c_size_t]
+        lib.ci_scheduler_destroy.restype = None
+        lib.ci_scheduler_destroy.argtypes = [ctypes.c_void_p]
+        lib.ci_scheduler_spawn.restype = ctypes.c_int
+        lib.ci_scheduler_spawn.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_char_p]
+        lib.ci_scheduler_step.restype = ctypes.c_int
+        lib.ci_scheduler_step.argtypes = [ctypes.c_void_p]
+        lib.ci_scheduler_run.restype = None
+        lib.ci_scheduler_run.argtypes = [ctypes.c_void_p]
+        lib.ci_task_status.restype = ctypes.c_int
+        lib.ci_task_status.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        lib.ci_task_latency.restype = ctypes.c_double
+        lib.ci_task_latency.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        return lib
+    return None
+
+c_engine = load_c_engine()
+
+# 在 C 引擎上运行的解释器，接口与 PythonInterpreter 相同，但按 C 版本的语义执行：
+# 整数按 32 位 int 运算并回绕，除法向零取整，比较运算的结果打印为 1/0，
+# 函数体可以看到调用者的变量，没有 return 的函数返回 0，参数个数不符时不报错
+class CInterpreter:
+    engine = 'c'
+    
+    def __init__(self, step_limit=0):
+        if c_engine is None:
+            raise RuntimeError("C engine library not found")
+        self.handle = c_engine.ci_create()
+        if not self.handle:
+            raise MemoryError("Could not create C interpreter")
+        # 每次 run 最多执行的步数，0 表示不限
+        c_engine.ci_set_step_limit(self.handle, step_limit)
+        self.captured = None
+        self.natives = []
+        # 回调对象必须一直持有，否则会被回收
+        self.callback = INPUT_CALLBACK(self.read_input)
+        c_engine.ci_set_input_callback(self.handle, self.callback, None)
+    
+    def __del__(self):
+        if getattr(self, 'handle', None) and c_engine is not None:
+            c_engine.ci_destroy(self.handle)
+            self.handle = None
+    
+    @staticmethod
+    def memory_stats():
+        """C 引擎的内存统计（整个进程共享），返回字典"""
+        stats = MemoryStats()
+        c_engine.ci_get_memory_stats(ctypes.byref(stats))
+        return {name: getattr(stats, name) for name, _ in MemoryStats._fields_}
+    
+    @property
+    def last_trace(self):
+        """上次运行出错前最近的执行轨迹（已解码的文本），没有出错时为空串"""
+        return c_engine.ci_last_trace(self.handle).decode('utf-8', 'replace')
+    
+    @property
+    def steps(self):
+        """最近一次运行执行的步数"""
+        return c_engine.ci_steps(self.handle)
+    
+    @property
+    def globals(self):
+        result = {}
+        value = ctypes.c_int()
+        for i in range(c_engine.ci_global_count(self.handle)):
+            name = c_engine.ci_global_name(self.handle, i)
+            if c_engine.ci_get_global(self.handle, name, ctypes.byref(value)):
+                result[name.decode('utf-8')] = value.value
+        return result
+    
+    def register_function(self, name, function):
+        """登记脚本可调用的函数；function 可以是接收整数参数、返回整数的 Python 函数，
+        也可以是 NATIVE_FUNCTION 类型的 ctypes 函数指针（例如取自另一个共享库）"""
+        if not isinstance(function, NATIVE_FUNCTION):
+            python_function = function
+            function = NATIVE_FUNCTION(lambda args, count: int(python_function(*args[:count])))
+        self.natives.append(function)
+        if c_engine.ci_register_function(self.handle, name.encode('utf-8'), function) != 0:
+            raise RuntimeError(c_engine.ci_last_error(self.handle).decode('utf-8', 'replace'))
+    
+    def run(self, code, inputs=None, capture=False):
+        """运行程序；inputs 中的值依次作为 input() 的结果，取完后从标准输入读取；
+        capture 为真时不输出，而是返回 print 输出的文本"""
+        for value in inputs or ():
+            c_engine.ci_push_input(self.handle, int(value))
+        self.captured = [] if capture else None
+        status = c_engine.ci_run(self.handle, code.encode('utf-8'))
+        self.flush_output()
+        if status != 0:
+            self.emit(c_engine.ci_last_error(self.handle).decode('utf-8', 'replace') + '\n')
+        if capture:
+            text = ''.join(self.captured)
+            self.captured = None
+            return text
+    
+    def emit(self, text):
+        if self.captured is not None:
+            self.captured.append(text)
+        else:
+            sys.stdout.write(text)
+    
+    def flush_output(self):
+        text = c_engine.ci_output(self.handle)
+        if text:
+            c_engine.ci_clear_output(self.handle)
+            self.emit(text.decode('utf-8', 'replace'))
+    
+    def read_input(self, user_data, value):
+        # 读取前先输出已有的 print 结果，交互程序的提示能及时显示
+        self.flush_output()
+        if self.captured is None:
+            sys.stdout.flush()
+        try:
+            value[0] = int(input())
+            return 1
+        except (ValueError, EOFError):
+            return 0
+
+# 默认使用闭包编译引擎，语义与 PythonInterpreter 相同；
+# C 引擎按 C 的语义运行（32 位回绕、除法向零取整、动态作用域等），只在 MINI_INTERPRETER_ENGINE=c 时使用
+if os.environ.get('MINI_INTERPRETER_ENGINE') == 'c':
+    if c_engine is None:
+        raise ImportError("MINI_INTERPRETER_ENGINE=c but the C engine library was not found")
+    Interpreter = CInterpreter
+elif os.environ.get('MINI_INTERPRETER_ENGINE') == 'python':
+    Interpreter = PythonInterpreter
+else:
+    Interpreter = ClosureInterpreter
+
 # 测试用例
 def test_basic_operations():
     code = """
@@ -539,6 +994,23 @@ def test_functions():
     interpreter.run(code)
     print()
 
+def test_call_statement():
+    # 作为语句调用时，返回表达式中的调用仍然执行，应输出 5
+    code = """
+    def g() {
+        print(5);
+        return 1;
+    }
+    def f() {
+        return g();
+    }
+    f();
+    """
+    print("Test 4: Call Statement")
+    interpreter = Interpreter()
+    interpreter.run(code)
+    print()
+
 def run_file(file_path):
     """运行指定路径的.c文件"""
     try:
@@ -559,3 +1031,4 @@ if __name__ == "__main__":
         test_basic_operations()
         test_control_flow()
         test_functions()
+        test_call_statement()
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""
+嵌入接口内存泄漏测试
+
+通过 ctypes 反复创建实例、运行一段含函数定义和数组的程序和一段在嵌套调用中出错的程序、再销毁实例，
+比较预热之后和之后各轮结束时进程的常驻内存（RSS），增长超过阈值时以非零状态退出。
+
+用法：
+    gcc -O2 -shared -fPIC -fvisibility=hidden -pthread -DCI_LIBRARY -o libc_interpreter.so c_interpreter.c
+    python tests/test_leak.py --lib ./libc_interpreter.so
+"""
+
+import argparse
+import ctypes
+import os
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+PROGRAM = b'''def square(int x) {
+    return x * x;
+}
+int data[64];
+int total = 0;
+for (int i = 0; i < 64; i = i + 1) {
+    data[i] = square(i);
+    total = total + data[i];
+}
+print(total);
+'''
+
+# 出错时跳过了两层函数的返回，它们声明的数组应在跳转前释放
+FAILING = b'''def inner(int x) {
+    int scratch[4096];
+    fill(scratch, x);
+    return 1 / x;
+}
+def outer(int x) {
+    int buffer[4096];
+    copy(buffer, buffer);
+    return inner(x);
+}
+int r = outer(0);
+'''
+
+
+def rss_kb():
+    with open('/proc/self/statm') as f:
+        pages = int(f.read().split()[1])
+    return pages * os.sysconf('SC_PAGE_SIZE') // 1024
+
+
+def run_batch(lib, count):
+    for _ in range(count):
+        handle = lib.ci_create()
+        if not handle:
+            raise SystemExit('ci_create failed')
+        if lib.ci_run(handle, PROGRAM) != 0:
+            raise SystemExit(lib.ci_last_error(handle).decode('utf-8', 'replace'))
+        if lib.ci_run(handle, FAILING) == 0:
+            raise SystemExit('failing program succeeded')
+        lib.ci_destroy(handle)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='RSS growth over repeated create / run / destroy')
+    parser.add_argument('--lib', default=os.path.join(ROOT, 'libc_interpreter.so'), help='shared library to load')
+    parser.add_argument('--runs', type=int, default=2000, help='runs per round')
+    parser.add_argument('--rounds', type=int, default=3, help='rounds measured after the warm-up round')
+    parser.add_argument('--limit-kb', type=int, default=4096, help='allowed RSS growth over all rounds')
+    args = parser.parse_args()
+
+    lib = ctypes.CDLL(args.lib)
+    lib.ci_create.restype = ctypes.c_void_p
+    lib.ci_create.argtypes = []
+    lib.ci_destroy.restype = None
+    lib.ci_destroy.argtypes = [ctypes.c_void_p]
+    lib.ci_run.restype = ctypes.c_int
+    lib.ci_run.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.ci_last_error.restype = ctypes.c_char_p
+    lib.ci_last_error.argtypes = [ctypes.c_void_p]
+
+    run_batch(lib, args.runs)
+    baseline = rss_kb()
+    print(f'after warm-up: {baseline} KB')
+    for round_index in range(args.rounds):
+        run_batch(lib, args.runs)
+        print(f'after round {round_index + 1}: {rss_kb()} KB')
+    growth = rss_kb() - baseline
+    if growth > args.limit_kb:
+        print(f'FAIL RSS grew by {growth} KB over {args.rounds * args.runs} runs')
+        sys.exit(1)
+    print(f'ok   RSS grew by {growth} KB over {args.rounds * args.runs} runs')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""
+并行前端一致性测试
+
+用串行前端和 --jobs N 并行前端分别运行同一批程序（含嵌套 def、同名 def 覆盖，
+以及足够大、会被切成多个分块的程序），比较两者的输出，输出不同时以非零状态退出。
+
+用法：
+    gcc -O2 -o c_interpreter c_interpreter.c -pthread
+    python tests/test_parallel_frontend.py --bin ./c_interpreter
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+# 分块至少 64 KB，填充语句让后面的 def 落到其他分块中
+PADDING = ''.join(f'int pad{i} = {i};\n' for i in range(6000))
+
+PROGRAMS = {
+    'nested_shadow': '''def f() {
+    def f() {
+        return 2;
+    }
+    return 1;
+}
+print(f());
+''',
+    'nested_calls_inner': '''def outer(int x) {
+    def inner(int y) {
+        return y * 10;
+    }
+    return inner(x) + 1;
+}
+print(outer(4));
+print(inner(5));
+''',
+    'redefined_later': '''def g() {
+    return 1;
+}
+print(g());
+def g() {
+    return 3;
+}
+print(g());
+''',
+    'defs_in_blocks': '''int k = 1;
+if (k > 0) {
+    def h() {
+        def h() {
+            return 7;
+        }
+        return 6;
+    }
+} else {
+    def h() {
+        return 5;
+    }
+}
+for (int i = 0; i < 2; i = i + 1) {
+    def loop_def(int v) {
+        return v + i;
+    }
+}
+print(h());
+print(loop_def(1));
+''',
+    'shadow_across_chunks': '''def s() {
+    return 1;
+}
+print(s());
+''' + PADDING + '''def s() {
+    def s() {
+        return 9;
+    }
+    return 8;
+}
+print(s());
+''',
+}
+
+
+def run(binary, path, jobs):
+    command = [binary] + (['--jobs', str(jobs)] if jobs > 1 else []) + [path]
+    result = subprocess.run(command, capture_output=True, text=True, stdin=subprocess.DEVNULL)
+    return result.returncode, result.stdout
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Serial vs parallel front end output')
+    parser.add_argument('--bin', default='./c_interpreter', help='interpreter binary (default ./c_interpreter)')
+    parser.add_argument('--jobs', type=int, default=4, help='threads for the parallel front end')
+    args = parser.parse_args()
+
+    failures = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        for name, code in PROGRAMS.items():
+            path = os.path.join(tmp, name + '.c')
+            with open(path, 'w') as out:
+                out.write(code)
+            serial = run(args.bin, path, 1)
+            parallel = run(args.bin, path, args.jobs)
+            if serial != parallel:
+                failures += 1
+                print(f'FAIL {name}: serial {serial!r}, --jobs {args.jobs} {parallel!r}')
+            else:
+                print(f'ok   {name}')
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == '__main__':
+    main()
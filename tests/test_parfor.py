@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""
+parfor 检查与结果测试
+
+每个用例是一段程序和期望的结果：要么是打印的输出（与把 parfor 换成 for 串行运行的输出一致），
+要么是检查应当报告的错误。任一用例不符合时以非零状态退出。
+
+用法：
+    gcc -O2 -o c_interpreter c_interpreter.c -pthread
+    python tests/test_parfor.py --bin ./c_interpreter
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+# (名字, 程序, 期望的错误信息；None 表示应当成功且与串行结果一致)
+CASES = [
+    ('sum', '''int t = 1;
+parfor (int i = 0; i < 100; i = i + 1) sum(t) {
+    t = t + i * 2 - 1;
+}
+print(t);
+''', None),
+    ('min_max', '''int lo = 1000;
+int hi = 0;
+parfor (int i = 0; i < 50; i = i + 1) min(lo) {
+    lo = min(lo, (i * 37) / 7 + 3);
+}
+parfor (int i = 0; i < 50; i = i + 1) max(hi) {
+    hi = max(hi, (i * 37) / 7 + 3);
+}
+print(lo);
+print(hi);
+''', None),
+    ('redeclare_loop_var', '''int a[100];
+parfor (int i = 0; i < 100; i = i + 1) {
+    int i = 0;
+    a[i] = 7;
+}
+''', 'Error: parfor body must not redeclare i'),
+    ('redeclare_reduce_var', '''int t = 0;
+parfor (int i = 0; i < 10; i = i + 1) sum(t) {
+    for (int t = 0; t < 2; t = t + 1) {
+        int x = t;
+    }
+}
+''', 'Error: parfor body must not redeclare t'),
+    ('reduce_wrong_form', '''int t = 1;
+parfor (int i = 0; i < 10; i = i + 1) sum(t) {
+    t = t * 2 + i;
+}
+''', 'Error: parfor reduction sum(t) must be updated as t = t + expr'),
+    ('reduce_reads_self', '''int t = 1;
+parfor (int i = 0; i < 10; i = i + 1) sum(t) {
+    t = t + t;
+}
+''', 'Error: parfor body reads reduction variable t outside its update'),
+    ('reduce_read_elsewhere', '''int t = 0;
+int a[10];
+parfor (int i = 0; i < 10; i = i + 1) sum(t) {
+    t = t + i;
+    a[i] = t;
+}
+''', 'Error: parfor body reads reduction variable t outside its update'),
+    ('callee_reads_reduce_var', '''def peek(int x) {
+    return t + x;
+}
+int t = 0;
+parfor (int i = 0; i < 10; i = i + 1) sum(t) {
+    t = t + peek(i);
+}
+''', 'Error: parfor body calls peek, which reads reduction variable t'),
+    ('callee_local_named_like_reduce_var', '''def twice(int t) {
+    int u = t;
+    t = u * 2;
+    return t;
+}
+int t = 0;
+parfor (int i = 0; i < 10; i = i + 1) sum(t) {
+    t = t + twice(i);
+}
+print(t);
+''', None),
+    ('min_wrong_op', '''int m = 100;
+parfor (int i = 0; i < 10; i = i + 1) min(m) {
+    m = max(m, i);
+}
+''', 'Error: parfor reduction min(m) must be updated as m = min(m, expr)'),
+    ('condition_not_comparison', '''int t = 0;
+parfor (int i = 0; i - 10; i = i + 1) sum(t) {
+    t = t + i;
+}
+print(t);
+''', 'Error: parfor loop must have the form (int i = a; i < b; i = i + c)'),
+    ('nested_through_call', '''def inner(int base) {
+    int s = 0;
+    parfor (int j = 0; j < 20; j = j + 1) sum(s) {
+        s = s + base * j;
+    }
+    return s;
+}
+int total = 0;
+parfor (int i = 0; i < 40; i = i + 1) sum(total) {
+    total = total + inner(i);
+}
+print(total);
+''', None),
+]
+
+
+def run(binary, path):
+    result = subprocess.run([binary, '--trace', '0', path], capture_output=True, text=True,
+                            stdin=subprocess.DEVNULL)
+    return result.returncode, result.stdout
+
+
+def main():
+    parser = argparse.ArgumentParser(description='parfor checks and results')
+    parser.add_argument('--bin', default='./c_interpreter', help='interpreter binary (default ./c_interpreter)')
+    args = parser.parse_args()
+
+    failures = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        for name, code, error in CASES:
+            path = os.path.join(tmp, name + '.c')
+            with open(path, 'w') as out:
+                out.write(code)
+            status, output = run(args.bin, path)
+            if error is not None:
+                ok = status != 0 and output.startswith(error)
+                expected = error
+            else:
+                serial_path = os.path.join(tmp, name + '_serial.c')
+                with open(serial_path, 'w') as out:
+                    out.write(re.sub(r'\)\s*(sum|min|max)\(\w+\)', ')', code.replace('parfor', 'for')))
+                expected = run(args.bin, serial_path)[1]
+                ok = status == 0 and output == expected
+            if ok:
+                print(f'ok   {name}')
+            else:
+                failures += 1
+                print(f'FAIL {name}: got {output!r} (status {status}), expected {expected!r}')
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == '__main__':
+    main()
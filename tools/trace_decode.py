@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""
+执行轨迹解码工具
+
+c_interpreter 收到 SIGUSR1（或崩溃信号）时把主线程的轨迹环形缓冲区写入
+c_interpreter.<pid>.trace，本工具把它解码为与出错时相同的文本格式。
+
+文件格式（本机字节序）：
+    "CITRACE1"、事件总数 (u64)、缓冲区槽数 (u32)、函数数 (u32)、
+    全部槽位 (u64 x 槽数)、以 '\\0' 结尾的函数名
+每个事件：低 8 位是事件类型，8-31 位是行号，高 32 位是附加数据。
+
+用法：
+    kill -USR1 <pid>
+    python tools/trace_decode.py c_interpreter.<pid>.trace --last 100
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = b'CITRACE1'
+
+TRACE_STATEMENT, TRACE_ENTER, TRACE_EXIT, TRACE_BRANCH = 1, 2, 3, 4
+
+# 与 c_interpreter.c 中的 node_type_names 一致
+NODE_TYPE_NAMES = [
+    'program', 'declaration', 'assignment', 'if', 'for', 'parfor', 'def', 'call', 'call',
+    'print', 'input', 'expression', 'number', 'identifier', 'return', 'array declaration',
+    'index', 'index assignment',
+]
+
+
+def load(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:8] != MAGIC:
+        raise SystemExit(f'{path}: not a trace dump')
+    count, size, function_count = struct.unpack_from('=QII', data, 8)
+    offset = 8 + 16
+    slots = struct.unpack_from(f'={size}Q', data, offset)
+    offset += 8 * size
+    names = data[offset:].split(b'\0')[:function_count]
+    return count, list(slots), [name.decode('utf-8', 'replace') for name in names]
+
+
+def decode(count, slots, names, last=None):
+    size = len(slots)
+    first = max(0, count - size)
+    if last is not None and last >= 0 and count - first > last:
+        first = count - last
+
+    def function_name(index):
+        return names[index] if index < len(names) else '?'
+
+    lines = [f'Trace (last {count - first} of {count} events):']
+    for i in range(first, count):
+        event = slots[i % size]
+        kind = event & 0xff
+        line = (event >> 8) & 0xffffff
+        data = event >> 32
+        if kind == TRACE_STATEMENT:
+            text = NODE_TYPE_NAMES[data] if data < len(NODE_TYPE_NAMES) else '?'
+        elif kind == TRACE_ENTER:
+            text = 'enter ' + function_name(data)
+        elif kind == TRACE_EXIT:
+            text = 'exit ' + function_name(data)
+        elif kind == TRACE_BRANCH:
+            text = 'branch ' + ('then' if data else 'else')
+        else:
+            text = f'unknown event {kind}'
+        lines.append(f'  line {line}: {text}')
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode a c_interpreter trace dump')
+    parser.add_argument('dump', help='trace file written on SIGUSR1 or a crash')
+    parser.add_argument('--last', type=int, default=None, help='only show the last N events (default: all)')
+    args = parser.parse_args()
+
+    count, slots, names = load(args.dump)
+    sys.stdout.write(decode(count, slots, names, args.last) + '\n')
+
+
+if __name__ == '__main__':
+    main()